@@ -1,9 +1,10 @@
 #include "util/Core.h"
 
 #include <cstdint>
+#include <vector>
 
 class FuelCalculator : public AoC::Solver<uint32_t, uint32_t> {
-  std::istream& in;
+  std::vector<uint32_t> masses;
 
   [[nodiscard]] static uint32_t CalculateFuelForMass(uint32_t mass) noexcept {
     mass = mass / 3;
@@ -11,17 +12,18 @@ class FuelCalculator : public AoC::Solver<uint32_t, uint32_t> {
   }
 
  public:
-  FuelCalculator(std::istream& in, std::vector<std::string>) : in{in} {}
+  FuelCalculator(const AoC::InputView& input, std::vector<std::string>)
+    : masses{AoC::ParseDelimited<decltype(masses)>(input.Text())} {}
 
   [[nodiscard]] Results Solve() override {
     uint32_t massFuel = 0, fuelForFuel = 0;
-    AoC::ForEachInStream(in, 0U, [&massFuel, &fuelForFuel](uint32_t mass) {
+    for (auto mass : masses) {
       const auto fuel = CalculateFuelForMass(mass);
       massFuel += fuel;
       for (auto i = CalculateFuelForMass(fuel); i > 0;
            i      = CalculateFuelForMass(i))
         fuelForFuel += i;
-    });
+    }
     return {massFuel, massFuel + fuelForFuel};
   }
 };
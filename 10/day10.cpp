@@ -59,21 +59,12 @@ class MonitoringStation : public AoC::Solver<int32_t, uint32_t> {
   Point baseLocation;
 
  public:
-  MonitoringStation(std::istream& in, const std::vector<std::string>&) {
-    auto x = 0, y = 0;
-    while (in && !in.eof()) {
-      switch (in.get()) {
-      case '#':
+  MonitoringStation(const AoC::InputView& input,
+                    const std::vector<std::string>&) {
+    AoC::ForEachCell(input.Text(), [this](size_t x, size_t y, char cell) {
+      if (cell == '#')
         asteroids.emplace_back(x, y);
-        [[fallthrough]];
-      case '.':
-        ++x;
-        break;
-      case '\n':
-        ++y;
-        x = 0;
-      }
-    }
+    });
   }
 
   int32_t SolvePart1() {
@@ -1,166 +1,17 @@
 #include "util/Core.h"
+#include "util/IntCode.h"
+#include "util/IntCodeCoro.h"
+#ifdef AOC_DAY11_AOT
+#  include "aot/day11_image.h"
+#  include "util/IntCodeAot.h"
+#endif
 
 #include <cstdint>
-#include <queue>
 #include <set>
 #include <sstream>
 #include <utility>
 #include <unordered_set>
 
-enum class ParamMode {
-  POSITION,
-  IMMEDIATE,
-  RELATIVE,
-};
-class Insn {
-  uint8_t opCode;
-  ParamMode paramA;
-  ParamMode paramB;
-  ParamMode paramC;
-
-  static ParamMode GetMode(int32_t val) {
-    switch (val) {
-    case 0:
-      return ParamMode::POSITION;
-    case 1:
-      return ParamMode::IMMEDIATE;
-    case 2:
-      return ParamMode::RELATIVE;
-    }
-    throw std::runtime_error{"Invalid ParamMode"};
-  }
-
- public:
-  explicit Insn(int64_t op) {
-    opCode = op % 100;
-    paramA = GetMode((op / 100) % 10);
-    paramB = GetMode((op / 1000) % 10);
-    paramC = GetMode((op / 10000) % 10);
-  }
-  [[nodiscard]] uint8_t OpCode() const noexcept { return opCode; }
-  [[nodiscard]] ParamMode ParamA() const noexcept { return paramA; }
-  [[nodiscard]] ParamMode ParamB() const noexcept { return paramB; }
-  [[nodiscard]] ParamMode ParamC() const noexcept { return paramC; }
-};
-
-enum class ExecState { NEED_INPUT, HAS_OUTPUT, HALTED };
-
-class IntCodeComputer {
-  std::vector<int64_t> mem;
-  std::queue<int64_t> input;
-  int64_t insnPtr = 0;
-  int64_t relPtr  = 0;
-  int64_t out     = 0;
-
-  int64_t& GetArg(const ParamMode mode) {
-    switch (mode) {
-    case ParamMode::POSITION:
-      return mem[mem[insnPtr++]];
-    case ParamMode::IMMEDIATE:
-      return mem[insnPtr++];
-    case ParamMode::RELATIVE:
-      return mem[mem[insnPtr++] + relPtr];
-    }
-  }
-
-  std::pair<int64_t, int64_t> GetArgs(const Insn& op) {
-    auto a = GetArg(op.ParamA());
-    auto b = GetArg(op.ParamB());
-    return {a, b};
-  }
-
-  void Add(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    GetArg(op.ParamC()) = a + b;
-  }
-
-  void Multiply(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    GetArg(op.ParamC()) = a * b;
-  }
-
-  void JumpIfTrue(const Insn& op) {
-    auto [a, b] = GetArgs(op);
-    if (a)
-      insnPtr = b;
-  }
-
-  void JumpIfFalse(const Insn& op) {
-    auto [a, b] = GetArgs(op);
-    if (!a)
-      insnPtr = b;
-  }
-
-  void LessThan(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    GetArg(op.ParamC()) = a < b;
-  }
-
-  void Equals(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    GetArg(op.ParamC()) = a == b;
-  }
-
-  void AdjustRelPtr(const Insn& op) { relPtr += GetArg(op.ParamA()); }
-
-  void Store(int64_t input, const Insn& op) { GetArg(op.ParamA()) = input; }
-
-  int64_t Load(const Insn& op) { return GetArg(op.ParamA()); }
-
- public:
-  IntCodeComputer(const std::vector<int64_t>& mem)
-    : mem(std::max(81920UL, mem.size()), 0) {
-    std::copy(mem.begin(), mem.end(), this->mem.begin());
-  }
-
-  [[nodiscard]] int64_t Out() const noexcept { return out; }
-
-  IntCodeComputer& PushInput(int64_t val) {
-    input.push(val);
-    return *this;
-  }
-
-  [[nodiscard]] ExecState Execute() {
-    while (true) {
-      Insn op{mem[insnPtr++]};
-      switch (op.OpCode()) {
-      case 1:
-        Add(op);
-        break;
-      case 2:
-        Multiply(op);
-        break;
-      case 3:
-        if (input.empty())
-          return ExecState::NEED_INPUT;
-        Store(input.front(), op);
-        input.pop();
-        break;
-      case 4:
-        out = Load(op);
-        return ExecState::HAS_OUTPUT;
-      case 5:
-        JumpIfTrue(op);
-        break;
-      case 6:
-        JumpIfFalse(op);
-        break;
-      case 7:
-        LessThan(op);
-        break;
-      case 8:
-        Equals(op);
-        break;
-      case 9:
-        AdjustRelPtr(op);
-        break;
-      case 99:
-        return ExecState::HALTED;
-      }
-    }
-  }
-};
-
 struct Point {
   int32_t x = 0;
   int32_t y = 0;
@@ -230,27 +81,41 @@ class PaintRobot : public AoC::Solver<int64_t, std::string> {
   std::vector<int64_t> mem;
   Point pos{0, 0};
 
- public:
-  PaintRobot(std::istream& in, const std::vector<std::string>&)
-    : mem{AoC::StreamToContainer<decltype(mem)>(in, ',')} {}
+  // The input compiled in with INTCODE_AOT_DAY11, if any, runs natively;
+  // any other input is interpreted.
+  [[nodiscard]] auto MakeRobot() const {
+#ifdef AOC_DAY11_AOT
+    return AoC::IntCodeAot{AoC::Aot::day11_image, mem};
+#else
+    return AoC::IntCodeComputer{mem};
+#endif
+  }
 
-  template <class WhitePanels, class PaintedPanels>
-  void Paint(WhitePanels& whitePanels, PaintedPanels& paintedPanels, int init) {
-    IntCodeComputer robot{mem};
-    robot.PushInput(init);
+ public:
+  // Each part paints with a robot of its own.
+  static constexpr bool INDEPENDENT_PARTS = true;
+
+  PaintRobot(const AoC::InputView& input, const std::vector<std::string>&)
+    : mem{AoC::ParseDelimited<decltype(mem)>(input.Text(), ',')} {}
+
+  // Each step is a colour and a turn, answered with the colour under the
+  // robot's new position.
+  template <class Robot, class WhitePanels, class PaintedPanels>
+  static AoC::IntCodeTask Drive(AoC::IntCodeDevice<Robot>& robot,
+                                WhitePanels& whitePanels,
+                                PaintedPanels& paintedPanels) {
     auto x = 0, y = 0;
     Dir dir;
-    while (robot.Execute() != ExecState::HALTED) {
-      auto paintColour = robot.Out();
-      if (robot.Execute() != ExecState::HAS_OUTPUT)
+    while (auto paintColour = co_await robot.Read()) {
+      auto direction = co_await robot.Read();
+      if (!direction)
         throw std::logic_error{"IntCode in invalid state"};
-      auto direction = robot.Out();
       paintedPanels.emplace(x, y);
-      if (paintColour == 1)
+      if (*paintColour == 1)
         whitePanels.emplace(x, y);
       else
         whitePanels.erase(Panel{x, y});
-      if (direction == 0)
+      if (*direction == 0)
         dir.TurnLeft();
       else
         dir.TurnRight();
@@ -262,10 +127,21 @@ class PaintRobot : public AoC::Solver<int64_t, std::string> {
         --x;
       else if (dir == Direction::RIGHT)
         ++x;
-      robot.PushInput(whitePanels.count(Panel{x, y}) ? 1 : 0);
+      co_await robot.Write(whitePanels.count(Panel{x, y}) ? 1 : 0);
     }
   }
 
+  template <class WhitePanels, class PaintedPanels>
+  void Paint(WhitePanels& whitePanels, PaintedPanels& paintedPanels, int init) {
+    auto comp = MakeRobot();
+    comp.PushInput(init);
+    AoC::IntCodeScheduler scheduler;
+    AoC::IntCodeDevice robot{scheduler, comp};
+    auto task = Drive(robot, whitePanels, paintedPanels);
+    scheduler.Run();
+    task.Get();
+  }
+
   int64_t SolvePart1() {
     std::unordered_set<Panel, Panel::Hash> whitePanels;
     std::unordered_set<Panel, Panel::Hash> paintedPanels;
@@ -84,6 +84,9 @@ class NBodyProblem : public AoC::Solver<uint64_t, uint64_t> {
   }
 
  public:
+  // Both parts simulate their own copy of the moons.
+  static constexpr bool INDEPENDENT_PARTS = true;
+
   NBodyProblem(std::istream& in, const std::vector<std::string>&) {
     while (true) {
       auto moon = GetMoon(in);
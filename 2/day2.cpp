@@ -1,62 +1,188 @@
 #include "util/Core.h"
+#include "util/IntCode.h"
+#include "util/IntCodeBatch.h"
 
 #include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 
-class IntCode : public AoC::Solver<uint32_t, uint32_t> {
-  std::vector<uint32_t> mem;
-  static constexpr uint32_t target = 19690720;
+// A polynomial in the noun and verb, stored as a coefficient per pair of
+// exponents. Zero coefficients are never stored. Arithmetic wraps modulo
+// 2^64, as the computer's does, so evaluating it gives exactly what running
+// the program would.
+class Polynomial {
+  std::map<std::pair<int, int>, uint64_t> terms;
 
-  static void Add(uint16_t pos, std::vector<uint32_t>& memory) {
-    memory[memory[pos + 2]] = memory[memory[pos]] + memory[memory[pos + 1]];
+  static uint64_t Pow(uint64_t base, int exp) {
+    uint64_t ret = 1;
+    while (exp--)
+      ret *= base;
+    return ret;
   }
 
-  static void Multiply(uint16_t pos, std::vector<uint32_t>& memory) {
-    memory[memory[pos + 2]] = memory[memory[pos]] * memory[memory[pos + 1]];
+  void AddTerm(std::pair<int, int> exps, uint64_t coeff) {
+    if ((terms[exps] += coeff) == 0)
+      terms.erase(exps);
   }
 
-  static void Execute(std::vector<uint32_t>& mem) {
-    auto pos = 0;
-    while (true) {
-      switch (mem[pos]) {
-      case 1:
-        Add(pos + 1, mem);
-        pos += 4;
-        break;
-      case 2:
-        Multiply(pos + 1, mem);
-        pos += 4;
-        break;
-      case 99:
-        return;
-      }
+ public:
+  Polynomial() = default;
+  Polynomial(int64_t constant) {
+    if (constant)
+      terms[{0, 0}] = static_cast<uint64_t>(constant);
+  }
+
+  static Polynomial Noun() { return Var({1, 0}); }
+  static Polynomial Verb() { return Var({0, 1}); }
+  static Polynomial Var(std::pair<int, int> exps) {
+    Polynomial ret;
+    ret.terms[exps] = 1;
+    return ret;
+  }
+
+  [[nodiscard]] std::optional<int64_t> Constant() const {
+    if (terms.empty())
+      return 0;
+    if (terms.size() == 1 && terms.begin()->first == std::pair{0, 0})
+      return static_cast<int64_t>(terms.begin()->second);
+    return std::nullopt;
+  }
+
+  Polynomial operator+(const Polynomial& rhs) const {
+    auto ret = *this;
+    for (auto& [exps, coeff] : rhs.terms)
+      ret.AddTerm(exps, coeff);
+    return ret;
+  }
+
+  Polynomial operator*(const Polynomial& rhs) const {
+    Polynomial ret;
+    for (auto& [lExps, lCoeff] : terms) {
+      for (auto& [rExps, rCoeff] : rhs.terms)
+        ret.AddTerm({lExps.first + rExps.first, lExps.second + rExps.second},
+                    lCoeff * rCoeff);
     }
+    return ret;
   }
 
-  uint32_t SolvePart2() {
-    for (auto i = 0; i <= 99; ++i) {
-      for (auto j = 0; j <= 99; ++j) {
-        auto memTmp = mem;
-        memTmp[1]   = i;
-        memTmp[2]   = j;
-        Execute(memTmp);
-        if (memTmp[0] == target)
-          return (100 * i) + j;
+  [[nodiscard]] int64_t Eval(int64_t noun, int64_t verb) const {
+    uint64_t ret = 0;
+    for (auto& [exps, coeff] : terms)
+      ret += coeff * Pow(noun, exps.first) * Pow(verb, exps.second);
+    return static_cast<int64_t>(ret);
+  }
+};
+
+class IntCode : public AoC::Solver<int64_t, int64_t> {
+  using Computer = AoC::IntCodeMachine<AoC::IntCodeArithmeticSpec>;
+
+  std::vector<int64_t> image;
+  Computer program;
+  static constexpr int64_t target     = 19690720;
+  static constexpr int64_t maxOperand = 99;
+
+  // Runs a fork of the program, so each attempt only copies the page holding
+  // the noun and verb rather than the whole image.
+  [[nodiscard]] int64_t Run(int64_t noun, int64_t verb) {
+    auto comp = program.Fork();
+    comp.Poke(1, noun).Poke(2, verb);
+    if (comp.Execute() != AoC::ExecState::HALTED)
+      throw std::runtime_error{"Program did not halt"};
+    return comp.Peek(0);
+  }
+
+  // Evaluates the program once with the noun and verb left as unknowns,
+  // returning the final value of address 0. A read through an address which
+  // depends on the unknowns gives an unknown value, which is fine as long as
+  // it is overwritten before it matters. Gives up if an opcode, a destination
+  // or the result is unknown, or if the program strays outside its image or
+  // uses anything but add and multiply.
+  [[nodiscard]] std::optional<Polynomial> RunSymbolic() const {
+    std::vector<std::optional<Polynomial>> mem{image.begin(), image.end()};
+    if (mem.size() < 3)
+      return std::nullopt;
+    mem[1] = Polynomial::Noun();
+    mem[2] = Polynomial::Verb();
+    auto addr = [&](size_t pos) -> std::optional<size_t> {
+      if (pos >= mem.size() || !mem[pos])
+        return std::nullopt;
+      auto val = mem[pos]->Constant();
+      if (!val || *val < 0 || *val >= static_cast<int64_t>(mem.size()))
+        return std::nullopt;
+      return *val;
+    };
+    auto load = [&](size_t pos) -> std::optional<Polynomial> {
+      const auto src = addr(pos);
+      return src ? mem[*src] : std::nullopt;
+    };
+    for (size_t pos = 0; pos < mem.size(); pos += 4) {
+      const auto op = mem[pos] ? mem[pos]->Constant() : std::nullopt;
+      if (op == 99)
+        return mem[0];
+      const auto dst = addr(pos + 3);
+      if ((op != 1 && op != 2) || !dst)
+        return std::nullopt;
+      const auto a = load(pos + 1), b = load(pos + 2);
+      if (!a || !b)
+        mem[*dst] = std::nullopt;
+      else
+        mem[*dst] = op == 1 ? *a + *b : *a * *b;
+    }
+    return std::nullopt;
+  }
+
+  // Finds the smallest verb for each noun in turn, matching the order of the
+  // brute force search. Solving for the verb would need division, which
+  // wrapping arithmetic doesn't have, so each pair is evaluated instead.
+  [[nodiscard]] std::optional<int64_t> SolveSymbolic() const {
+    const auto result = RunSymbolic();
+    if (!result)
+      return std::nullopt;
+    for (int64_t noun = 0; noun <= maxOperand; ++noun) {
+      for (int64_t verb = 0; verb <= maxOperand; ++verb) {
+        if (result->Eval(noun, verb) == target)
+          return (100 * noun) + verb;
       }
     }
     return 0;
   }
 
+  // Tries every verb for a noun at once, one verb per batch lane.
+  [[nodiscard]] std::optional<int64_t> SearchNoun(int64_t noun) const {
+    AoC::IntCodeBatch batch{image, maxOperand + 1};
+    for (int64_t verb = 0; verb <= maxOperand; ++verb)
+      batch.Poke(verb, 1, noun).Poke(verb, 2, verb);
+    batch.Execute();
+    for (int64_t verb = 0; verb <= maxOperand; ++verb) {
+      if (batch.State(verb) != AoC::ExecState::HALTED)
+        throw std::runtime_error{"Program did not halt"};
+      if (batch.Peek(verb, 0) == target)
+        return (100 * noun) + verb;
+    }
+    return std::nullopt;
+  }
+
  public:
-  IntCode(std::istream& in, std::vector<std::string>)
-    : mem{AoC::StreamToContainer<decltype(mem)>(in, ',')} {
-    mem[1] = 12;
-    mem[2] = 2;
+  int64_t SolvePart1() { return Run(12, 2); }
+
+  int64_t SolvePart2() {
+    if (auto ret = SolveSymbolic())
+      return *ret;
+    for (auto noun = 0; noun <= maxOperand; ++noun) {
+      if (auto ret = SearchNoun(noun))
+        return *ret;
+    }
+    return 0;
   }
 
+  IntCode(const AoC::InputView& input, std::vector<std::string>)
+    : image{AoC::ParseDelimited<decltype(image)>(input.Text(), ',')},
+      program{image} {}
+
   [[nodiscard]] Results Solve() override {
-    auto mem1 = mem;
-    Execute(mem1); // Part 1
-    return {mem1[0], SolvePart2()};
+    return {SolvePart1(), SolvePart2()};
   }
 };
 
@@ -4,6 +4,7 @@
 #include <cmath>
 #include <cstdint>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 struct Point {
@@ -75,13 +76,14 @@ class CrossedWires : public AoC::Solver<uint32_t, uint32_t> {
     return std::abs(a.x - b.x) + std::abs(a.y - b.y);
   }
 
-  static void ProcessWire(std::vector<WirePiece>& wire, std::istream& in) {
-    char dir      = 0;
-    uint32_t dist = 0;
+  static void ProcessWire(std::vector<WirePiece>& wire,
+                          std::string_view line) {
     Point curLoc;
-    while (in) {
-      in >> dir;
-      in >> dist;
+    while (!line.empty()) {
+      const auto end  = std::min(line.find(','), line.size());
+      const auto dir  = line[0];
+      const auto dist = AoC::ParseNumber<uint32_t>(line.substr(1, end - 1));
+      line.remove_prefix(std::min(end + 1, line.size()));
       switch (dir) {
       case 'U':
         curLoc = Up(wire, dist, curLoc);
@@ -96,10 +98,10 @@ class CrossedWires : public AoC::Solver<uint32_t, uint32_t> {
         curLoc = Right(wire, dist, curLoc);
         break;
       }
-      if (in.get() == '\n')
-        return;
     }
   }
+
+ public:
   uint32_t SolvePart1() {
     auto dist = std::numeric_limits<uint32_t>::max();
     for (const auto& a : wireA) {
@@ -129,10 +131,13 @@ class CrossedWires : public AoC::Solver<uint32_t, uint32_t> {
     return ret;
   }
 
- public:
-  CrossedWires(std::istream& in, const std::vector<std::string>&) {
-    ProcessWire(wireA, in);
-    ProcessWire(wireB, in);
+  CrossedWires(const AoC::InputView& input, const std::vector<std::string>&) {
+    auto* wire = &wireA;
+    AoC::ForEachLine(input.Text(), [&](std::string_view line) {
+      if (wire)
+        ProcessWire(*wire, line);
+      wire = wire == &wireA ? &wireB : nullptr;
+    });
   }
   [[nodiscard]] Results Solve() override {
     return {SolvePart1(), SolvePart2()};
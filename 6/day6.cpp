@@ -57,16 +57,16 @@ class CelestialOrbits : public AoC::Solver<uint32_t, uint32_t> {
   }
 
  public:
-  CelestialOrbits(std::istream& in, const std::vector<std::string>&) {
-    std::string line;
-    while (std::getline(in, line)) {
-      auto sep = line.find(')');
-      std::string_view a{line.data(), sep};
-      std::string_view b{line.data() + sep + 1, line.size() - sep - 1};
-      auto parent = bodies.emplace(a);
-      auto child  = bodies.emplace(b);
+  CelestialOrbits(const AoC::InputView& input,
+                  const std::vector<std::string>&) {
+    AoC::ForEachLine(input.Text(), [this](std::string_view line) {
+      const auto sep = line.find(')');
+      if (sep == std::string_view::npos)
+        return;
+      auto parent = bodies.emplace(line.substr(0, sep));
+      auto child  = bodies.emplace(line.substr(sep + 1));
       child.first->SetParent(*parent.first);
-    }
+    });
   }
 
   [[nodiscard]] Results Solve() {
@@ -1,220 +1,215 @@
 #include "util/Core.h"
+#include "util/IntCode.h"
+#include "util/IntCodeCoro.h"
+#include "util/Parallel.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <functional>
-#include <queue>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <utility>
-
-enum class ParamMode {
-  POSITION,
-  IMMEDIATE,
-};
-class Insn {
-  uint8_t opCode;
-  ParamMode paramA;
-  ParamMode paramB;
-  ParamMode paramC;
-
- public:
-  explicit Insn(int32_t op) {
-    opCode = op % 100;
-    paramA = (op / 100) % 10 ? ParamMode::IMMEDIATE : ParamMode::POSITION;
-    paramB = (op / 1000) % 10 ? ParamMode::IMMEDIATE : ParamMode::POSITION;
-    paramC = (op / 10000) % 10 ? ParamMode::IMMEDIATE : ParamMode::POSITION;
-  }
-  [[nodiscard]] uint8_t OpCode() const noexcept { return opCode; }
-  [[nodiscard]] ParamMode ParamA() const noexcept { return paramA; }
-  [[nodiscard]] ParamMode ParamB() const noexcept { return paramB; }
-  [[nodiscard]] ParamMode ParamC() const noexcept { return paramC; }
-};
-
-enum class ExecState { NEED_INPUT, HAS_OUTPUT, HALTED };
-
-class IntCodeComputer {
-  std::vector<int32_t> mem;
-  std::queue<int32_t> input;
-  int32_t insnPtr = 0;
-  int32_t out     = 0;
-
-  std::pair<int32_t, int32_t> GetArgs(const Insn& op) {
-    auto a =
-      op.ParamA() == ParamMode::POSITION ? mem[mem[insnPtr++]] : mem[insnPtr++];
-    auto b =
-      op.ParamB() == ParamMode::POSITION ? mem[mem[insnPtr++]] : mem[insnPtr++];
-    return {a, b};
-  }
-
-  void Add(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    mem[mem[insnPtr++]] = a + b;
-  }
-
-  void Multiply(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    mem[mem[insnPtr++]] = a * b;
-  }
-
-  void JumpIfTrue(const Insn& op) {
-    auto [a, b] = GetArgs(op);
-    if (a)
-      insnPtr = b;
-  }
-
-  void JumpIfFalse(const Insn& op) {
-    auto [a, b] = GetArgs(op);
-    if (!a)
-      insnPtr = b;
-  }
-
-  void LessThan(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    mem[mem[insnPtr++]] = a < b;
-  }
-  void Equals(const Insn& op) {
-    auto [a, b]         = GetArgs(op);
-    mem[mem[insnPtr++]] = a == b;
-  }
-
-  static void Store(int32_t input, int32_t& dst) { dst = input; }
-
-  int32_t Load(const Insn& op, const int32_t* arg) {
-    return op.ParamA() == ParamMode::POSITION ? mem[*arg] : *arg;
-  }
-
- public:
-  IntCodeComputer(std::vector<int32_t> mem) : mem{std::move(mem)} {}
-
-  [[nodiscard]] int32_t Out() const noexcept { return out; }
-
-  IntCodeComputer& PushInput(int32_t val) {
-    input.push(val);
-    return *this;
-  }
-
-  [[nodiscard]] ExecState Execute() {
-    while (true) {
-      Insn op{mem[insnPtr++]};
-      switch (op.OpCode()) {
-      case 1:
-        Add(op);
-        break;
-      case 2:
-        Multiply(op);
-        break;
-      case 3:
-        if (input.empty())
-          return ExecState::NEED_INPUT;
-        Store(input.front(), mem[mem[insnPtr++]]);
-        input.pop();
-        break;
-      case 4:
-        out = Load(op, mem.data() + insnPtr++);
-        return ExecState::HAS_OUTPUT;
-      case 5:
-        JumpIfTrue(op);
-        break;
-      case 6:
-        JumpIfFalse(op);
-        break;
-      case 7:
-        LessThan(op);
-        break;
-      case 8:
-        Equals(op);
-        break;
-      case 99:
-        return ExecState::HALTED;
-      }
+#include <vector>
+
+class IntCode : public AoC::Solver<int64_t, int64_t> {
+  // No relative base, but 64-bit words: with more amplifiers the feedback
+  // loop's signal soon outgrows 32 bits.
+  using Computer = AoC::IntCodeMachine<
+    AoC::IntCodeSpec<int64_t, AoC::IntCodeNarrowSpec::OPS, true>>;
+  using Device   = AoC::IntCodeDevice<Computer>;
+  using Phases   = std::vector<int64_t>;
+  using Amps     = std::vector<Computer>;
+
+  // Phase settings [min, max], of which each amplifier takes a different one.
+  struct PhaseRange {
+    int64_t min;
+    int64_t max;
+    [[nodiscard]] size_t Size() const { return max - min + 1; }
+  };
+
+  std::vector<int64_t> mem;
+  size_t ampCount = 5;
+  PhaseRange chainPhases{0, 4};
+  PhaseRange loopPhases{5, 9};
+
+  // Ways to give k amplifiers distinct phases out of n. Throws if there are
+  // too many to count, let alone search.
+  static size_t Arrangements(size_t n, size_t k) {
+    size_t ret = 1;
+    for (auto i = n - k + 1; i <= n; ++i) {
+      if (__builtin_mul_overflow(ret, i, &ret))
+        throw std::overflow_error{"Too many phase arrangements to search"};
     }
-  }
-};
-
-class IntCode : public AoC::Solver<int32_t, int32_t> {
-  std::vector<int32_t> mem;
-
-  template <class Iter>
-  constexpr bool DigitUsed(int digit, Iter begin, Iter end) {
-    while (begin != end) {
-      if (*begin++ == digit) {
-        return true;
-      }
+    return ret;
+  }
+
+  // The index'th arrangement of phases in lexicographic order, so workers can
+  // each start part way through.
+  Phases NthArrangement(const PhaseRange& range, size_t index) const {
+    Phases unused(range.Size());
+    std::iota(unused.begin(), unused.end(), range.min);
+    Phases ret(ampCount);
+    for (size_t i = 0; i < ampCount; ++i) {
+      const auto block = Arrangements(unused.size() - 1, ampCount - 1 - i);
+      ret[i]           = unused[index / block];
+      unused.erase(unused.begin() + index / block);
+      index %= block;
     }
-    return false;
-  }
-
-  template <size_t N, class Func, class Iter>
-  constexpr void HandleDigit(int min,
-                             int max,
-                             Func&& func,
-                             std::array<int32_t, N>& arr,
-                             Iter iter) {
-    if (iter == arr.end())
-      return func(arr);
-    for (auto i = min; i <= max; ++i) {
-      if (!DigitUsed(i, arr.begin(), iter)) {
-        *iter = i;
-        HandleDigit(min, max, std::forward<Func>(func), arr, iter + 1);
+    return ret;
+  }
+
+  // Tries every arrangement of phases across all cores. Each worker keeps one
+  // set of amplifiers and resets it from the loaded program before every
+  // attempt, which reuses the memory it already has.
+  template <class Func>
+  int64_t Search(const PhaseRange& range, Func&& tryPhases) const {
+    const Computer program{mem};
+    return AoC::ParallelReduce(
+      Arrangements(range.Size(), ampCount),
+      int64_t{0},
+      [&] { return Amps(ampCount, program); },
+      [&](Amps& comps, size_t index) {
+        for (auto& comp : comps)
+          comp = program;
+        return tryPhases(comps, NthArrangement(range, index));
+      },
+      [](int64_t lhs, int64_t rhs) { return std::max(lhs, rhs); });
+  }
+
+  // Remembers each amplifier's output by phase and input signal, which is all
+  // it depends on in part 1.
+  class ChainCache {
+    struct Hash {
+      size_t operator()(const std::pair<int64_t, int64_t>& key) const {
+        const auto mixed = static_cast<uint64_t>(key.first) * 1000003 ^
+                           static_cast<uint64_t>(key.second);
+        return std::hash<uint64_t>{}(mixed);
+      }
+    };
+
+    const Computer& program;
+    Computer amp;
+    std::unordered_map<std::pair<int64_t, int64_t>,
+                       std::optional<int64_t>,
+                       Hash>
+      outputs;
+
+   public:
+    explicit ChainCache(const Computer& program)
+      : program{program}, amp{program} {}
+
+    std::optional<int64_t> Output(int64_t phase, int64_t signal) {
+      auto [iter, added] = outputs.try_emplace({phase, signal});
+      if (added) {
+        amp = program;
+        amp.PushInput(phase).PushInput(signal);
+        if (amp.Execute() == AoC::ExecState::HAS_OUTPUT)
+          iter->second = amp.Out();
       }
+      return iter->second;
     }
+  };
+
+  // Walks the tree of phase prefixes depth first, so every prefix is run once
+  // and each amplifier run is shared by every chain which reaches it with the
+  // same phase and signal. An amplifier which gives no output ends its chain
+  // with a signal of 0, as the last amplifier would never get to output.
+  int64_t BestChain(ChainCache& cache,
+                    uint64_t used,
+                    size_t depth,
+                    int64_t signal) const {
+    if (depth == ampCount)
+      return signal;
+    int64_t best = 0;
+    for (auto phase = chainPhases.min; phase <= chainPhases.max; ++phase) {
+      const auto bit = uint64_t{1} << (phase - chainPhases.min);
+      if (used & bit)
+        continue;
+      if (auto out = cache.Output(phase, signal))
+        best = std::max(best, BestChain(cache, used | bit, depth + 1, *out));
+    }
+    return best;
   }
 
-  template <int Min, int Max, class Func>
-  constexpr void ForEachCombination(Func&& func) {
-    std::array<int32_t, 1 + Max - Min> digits{};
-    for (auto i = Min; i <= Max; ++i) {
-      digits[0] = i;
-      HandleDigit(
-        Min, Max, std::forward<Func>(func), digits, digits.begin() + 1);
+  // Passes each output of one amplifier on to the next, remembering the last
+  // value passed.
+  static AoC::IntCodeTask Link(Device& from, Device& to, int64_t& last) {
+    while (auto val = co_await from.Read()) {
+      last = *val;
+      co_await to.Write(*val);
     }
   }
 
-  template <class CompArr, class ValArr>
-  int32_t TryLoop2(CompArr& comps, ValArr& vals) {
-    for (auto i = 0; i < comps.size(); ++i)
+  // Each amplifier feeds the next through a Link task, so the scheduler only
+  // runs an amplifier once it has input and someone waiting on its output.
+  static int64_t TryLoop(Amps& comps, const Phases& vals) {
+    AoC::IntCodeScheduler scheduler;
+    std::deque<Device> amps;
+    for (size_t i = 0; i < comps.size(); ++i) {
       comps[i].PushInput(vals[i]);
-    comps.front().PushInput(0);
-    for (auto state = ExecState::NEED_INPUT; state != ExecState::HALTED;) {
-      for (auto iter = comps.begin(); iter != comps.end(); ++iter) {
-        if ((state = iter->Execute()) == ExecState::HAS_OUTPUT) {
-          if ((iter + 1) == comps.end()) {
-            comps.front().PushInput(iter->Out());
-          } else {
-            (iter + 1)->PushInput(iter->Out());
-          }
-        }
-      }
+      amps.emplace_back(scheduler, comps[i]);
     }
-    return comps.back().Out();
-  }
-
-  int32_t SolvePart1() {
-    int32_t max = 0;
-    ForEachCombination<0, 4>([this, &max](auto& arr) {
-      auto comps = AoC::make_array<IntCodeComputer, 5>(mem);
-      for (auto i = 0; i < arr.size(); ++i)
-        comps[i].PushInput(arr[i]);
-      comps.front().PushInput(0);
-      for (auto i = comps.begin(); i != comps.end(); ++i) {
-        if (i->Execute() == ExecState::HAS_OUTPUT && (i + 1) != comps.end())
-          (i + 1)->PushInput(i->Out());
-      }
-      max = std::max(max, comps.back().Out());
-    });
-    return max;
+    comps.front().PushInput(0);
+    int64_t last = 0;
+    std::vector<AoC::IntCodeTask> links;
+    links.reserve(amps.size());
+    for (size_t i = 0; i < amps.size(); ++i)
+      links.emplace_back(Link(amps[i], amps[(i + 1) % amps.size()], last));
+    scheduler.Run();
+    for (auto& link : links)
+      link.Get();
+    return last;
   }
 
-  int32_t SolvePart2() {
-    int32_t max = 0;
-    ForEachCombination<5, 9>([this, &max](auto& arr) {
-      auto comps = AoC::make_array<IntCodeComputer, 5>(mem);
-      max        = std::max(max, TryLoop2(comps, arr));
-    });
-    return max;
+  void CheckRange(const PhaseRange& range) const {
+    if (range.max < range.min || range.Size() < ampCount || range.Size() > 64)
+      throw std::runtime_error{"Phase range must hold between the amplifier "
+                               "count and 64 phases"};
   }
 
  public:
-  IntCode(std::istream& in, const std::vector<std::string>&)
-    : mem{AoC::StreamToContainer<decltype(mem)>(in, ',')} {}
+  // Each first phase is a separate subtree, so they are shared out between
+  // workers, each with a cache of its own.
+  int64_t SolvePart1() const {
+    const Computer program{mem};
+    return AoC::ParallelReduce(
+      chainPhases.Size(),
+      int64_t{0},
+      [&] { return ChainCache{program}; },
+      [&](ChainCache& cache, size_t first) -> int64_t {
+        auto out = cache.Output(chainPhases.min + first, 0);
+        return out ? BestChain(cache, uint64_t{1} << first, 1, *out) : 0;
+      },
+      [](int64_t lhs, int64_t rhs) { return std::max(lhs, rhs); });
+  }
+
+  int64_t SolvePart2() const { return Search(loopPhases, TryLoop); }
+
+  // Optional arguments: amplifier count, then the part 1 and part 2 phase
+  // ranges as min max pairs. The ranges default to 0 and 5 onwards.
+  IntCode(const AoC::InputView& input, const std::vector<std::string>& args)
+    : mem{AoC::ParseDelimited<decltype(mem)>(input.Text(), ',')} {
+    if (args.size() > 5 || args.size() == 2 || args.size() == 4)
+      throw std::runtime_error{"Usage: day7 <input> [amplifiers [min1 max1 "
+                               "[min2 max2]]]"};
+    if (!args.empty()) {
+      ampCount    = std::stoul(args[0]);
+      chainPhases = {0, static_cast<int64_t>(ampCount) - 1};
+      loopPhases  = {5, static_cast<int64_t>(ampCount) + 4};
+    }
+    if (args.size() > 1)
+      chainPhases = {std::stoll(args[1]), std::stoll(args[2])};
+    if (args.size() > 3)
+      loopPhases = {std::stoll(args[3]), std::stoll(args[4])};
+    if (ampCount == 0)
+      throw std::runtime_error{"Need at least one amplifier"};
+    CheckRange(chainPhases);
+    CheckRange(loopPhases);
+  }
 
   [[nodiscard]] Results Solve() override {
     return {SolvePart1(), SolvePart2()};
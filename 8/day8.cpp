@@ -9,13 +9,14 @@ class DSNDecoder : public AoC::Solver<uint32_t, std::string> {
   std::vector<Layer> image;
 
  public:
-  DSNDecoder(std::istream& in, const std::vector<std::string>&) {
-    while (!in.eof()) {
+  DSNDecoder(const AoC::InputView& input, const std::vector<std::string>&) {
+    const auto text = input.Text();
+    for (size_t pos = 0; pos + WIDTH * HEIGHT <= text.size();
+         pos += WIDTH * HEIGHT) {
       Layer layer{};
-      for (auto& pixel : layer)
-        pixel = in.get() - 0x30;
-      if (in)
-        image.emplace_back(layer);
+      for (size_t i = 0; i < layer.size(); ++i)
+        layer[i] = text[pos + i] - 0x30;
+      image.emplace_back(layer);
     }
   }
 
@@ -0,0 +1,51 @@
+#ifndef AOC_BENCH_INTCODEBENCH
+#define AOC_BENCH_INTCODEBENCH
+
+#include "util/Core.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shared setup for the Intcode benchmarks. They all take
+// <program> [iterations] [inputs...] on the command line.
+namespace AoC::Bench {
+  struct IntCodeArgs {
+    std::vector<int64_t> program;
+    std::vector<int64_t> inputs;
+    size_t iterations = 10;
+  };
+
+  [[nodiscard]] inline IntCodeArgs ParseIntCodeArgs(int argc,
+                                                    const char* argv[]) {
+    if (argc < 2)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <program> [iterations] [inputs...]"};
+    IntCodeArgs ret;
+    ret.program =
+      ParseDelimited<std::vector<int64_t>>(InputView{argv[1]}.Text(), ',');
+    if (ret.program.empty())
+      throw std::runtime_error{"Could not read program"};
+    if (argc > 2)
+      ret.iterations = std::stoul(argv[2]);
+    for (auto i = 3; i < argc; ++i)
+      ret.inputs.emplace_back(std::stoll(argv[i]));
+    return ret;
+  }
+
+  // Queues every input up front and collects every output until the program
+  // stops producing them.
+  template <class State, class Computer, class Exec>
+  [[nodiscard]] std::vector<int64_t> RunToHalt(Computer comp,
+                                               const std::vector<int64_t>& in,
+                                               Exec exec) {
+    for (auto val : in)
+      comp.PushInput(val);
+    std::vector<int64_t> ret;
+    while (exec(comp) == State::HAS_OUTPUT)
+      ret.emplace_back(comp.Out());
+    return ret;
+  }
+} // namespace AoC::Bench
+
+#endif // AOC_BENCH_INTCODEBENCH
@@ -0,0 +1,177 @@
+#include "util/Bench.h"
+#include "util/IntCode.h"
+#include "util/IntCodeAsm.h"
+#include "util/IntCodeJit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Runs every engine over the synthetic workloads in bench/corpus, which are
+// assembled at startup, and reports Intcode instructions per second. Each
+// workload is sized to run for a second or two on the interpreter; scale
+// multiplies the work done. Every engine must produce the same outputs as
+// the first before anything is timed.
+// Usage: bench_intcode [scale] [iterations] [corpus directory]
+
+#ifndef AOC_INTCODE_CORPUS
+#  define AOC_INTCODE_CORPUS "bench/corpus"
+#endif
+
+namespace {
+  // The program's first input, which is all most of them take. With
+  // STREAMED, the program then reads that many more values, which are fed
+  // to it as it asks for them.
+  struct Workload {
+    std::string name;
+    std::function<int64_t(double scale)> size;
+    bool streamed = false;
+  };
+
+  const std::vector<Workload>& Workloads() {
+    static const std::vector<Workload> workloads{
+      {"sieve", [](double scale) { return std::llround(5e6 * scale); }},
+      // Insertion sort is quadratic.
+      {"sort",
+       [](double scale) { return std::llround(8000 * std::sqrt(scale)); }},
+      // The hash program only copes with sizes below 2^25.
+      {"hash",
+       [](double scale) {
+         return std::min<int64_t>(std::llround(5e6 * scale), 33554431);
+       }},
+      // Each step up in n makes for about phi times the calls.
+      {"fib",
+       [](double scale) {
+         const auto steps = std::lround(std::log(scale) / std::log(1.618));
+         return std::max<int64_t>(33 + steps, 1);
+       }},
+      {"echo", [](double scale) { return std::llround(1e7 * scale); }, true},
+    };
+    return workloads;
+  }
+
+  constexpr size_t CHUNK = 4096;
+
+  // Runs the program to completion and returns a checksum of its outputs.
+  template <class Computer, class Exec>
+  uint64_t Run(Computer& comp, int64_t size, bool streamed, Exec exec) {
+    comp.PushInput(size);
+    const int64_t inputs = streamed ? size : 0;
+    int64_t sent         = 0;
+    uint64_t ret         = 0;
+    while (true) {
+      const auto state = exec(comp);
+      while (comp.OutputCount())
+        ret = ret * 31 + static_cast<uint64_t>(comp.PopOutput());
+      if (state == AoC::ExecState::HALTED)
+        return ret;
+      if (state == AoC::ExecState::NEED_INPUT) {
+        if (sent == inputs)
+          throw std::runtime_error{"Program wants more input than it got"};
+        for (size_t i = 0; i < CHUNK && sent < inputs; ++i)
+          comp.PushInput(sent++);
+      }
+    }
+  }
+
+  struct Counter : AoC::IntCodeNoTrace {
+    static constexpr bool ENABLED = true;
+    uint64_t count                = 0;
+    void OnInsn(int64_t, AoC::Insn, int64_t) noexcept { ++count; }
+  };
+
+  struct Engine {
+    std::string name;
+    std::function<uint64_t(const std::vector<int64_t>&, int64_t, bool)> run;
+  };
+
+  template <AoC::Dispatch D, AoC::Fusion F = AoC::Fusion::OFF>
+  uint64_t Interpret(const std::vector<int64_t>& program,
+                     int64_t size,
+                     bool streamed) {
+    AoC::IntCodeComputer comp{program, F};
+    return Run(comp, size, streamed, [](auto& comp) {
+      return comp.template RunUntil<D>(CHUNK);
+    });
+  }
+
+  uint64_t Jit(const std::vector<int64_t>& program,
+               int64_t size,
+               bool streamed) {
+    AoC::IntCodeJit comp{program};
+    return Run(comp, size, streamed,
+               [](auto& comp) { return comp.RunUntil(CHUNK); });
+  }
+
+  const std::vector<Engine>& Engines() {
+    static const std::vector<Engine> engines{
+      {"switch", Interpret<AoC::Dispatch::SWITCH>},
+      {"switch, fused", Interpret<AoC::Dispatch::SWITCH, AoC::Fusion::ON>},
+      {"threaded", Interpret<AoC::Dispatch::THREADED>},
+      {"jit", Jit},
+    };
+    return engines;
+  }
+
+  // Instructions the program executes, with superinstructions unfused.
+  uint64_t Count(const std::vector<int64_t>& program,
+                 int64_t size,
+                 bool streamed) {
+    AoC::BasicIntCodeComputer<Counter> comp{program, AoC::Fusion::OFF};
+    static_cast<void>(Run(comp, size, streamed, [](auto& comp) {
+      return comp.RunUntil(CHUNK);
+    }));
+    return comp.GetTrace().count;
+  }
+
+  std::vector<int64_t> Assemble(const std::string& path) {
+    std::ifstream file{path};
+    if (!file)
+      throw std::runtime_error{"Could not open " + path};
+    const std::string source{std::istreambuf_iterator<char>{file}, {}};
+    return AoC::IntCodeAssemble(source);
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    const double scale       = argc > 1 ? std::stod(argv[1]) : 1;
+    const size_t iterations  = argc > 2 ? std::stoul(argv[2]) : 3;
+    const std::string corpus = argc > 3 ? argv[3] : AOC_INTCODE_CORPUS;
+    if (scale <= 0 || !iterations)
+      throw std::runtime_error{"Scale and iterations must be positive"};
+
+    for (auto& workload : Workloads()) {
+      const auto program = Assemble(corpus + "/" + workload.name + ".icasm");
+      const auto size    = workload.size(scale);
+      const auto count   = Count(program, size, workload.streamed);
+      std::cout << workload.name << " (n = " << size << ", " << count
+                << " instructions)\n";
+      std::optional<uint64_t> expected;
+      for (auto& engine : Engines()) {
+        const auto result = engine.run(program, size, workload.streamed);
+        if (expected && result != *expected)
+          throw std::runtime_error{engine.name + " disagrees on " +
+                                   workload.name};
+        expected   = result;
+        auto stats = AoC::Bench::Measure(
+          [&] { return engine.run(program, size, workload.streamed); },
+          iterations, 0);
+        AoC::Bench::Print(std::cout, "  " + engine.name, stats);
+        std::cout << "    " << count / (stats.median / 1e3)
+                  << " Mops/s (median)\n";
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "aot/aot_patch.h"
+#include "aot/aot_sample.h"
+#include "bench/IntCodeBench.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+#include "util/IntCodeAot.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Differential check and benchmark of ahead-of-time compiled Intcode against
+// the interpreter. The programs are translated at build time: aot_sample is
+// INTCODE_AOT_PROGRAM (a recursive Fibonacci by default, whose input
+// defaults to 24) and aot_patch rewrites its own operands. The sample is
+// also run from a different image, which must fall back to interpreting.
+// Usage: bench_intcode_aot [iterations] [inputs...]
+
+namespace {
+  std::vector<int64_t> Image(const AoC::IntCodeAotProgram& program) {
+    return {program.image, program.image + program.imageSize};
+  }
+
+  std::vector<int64_t> RunInterpreter(const std::vector<int64_t>& image,
+                                      const std::vector<int64_t>& inputs) {
+    return AoC::Bench::RunToHalt<AoC::ExecState>(
+      AoC::IntCodeComputer{image},
+      inputs,
+      [](auto& comp) { return comp.Execute(); });
+  }
+
+  std::vector<int64_t> RunAot(const AoC::IntCodeAotProgram& program,
+                              const std::vector<int64_t>& image,
+                              const std::vector<int64_t>& inputs) {
+    return AoC::Bench::RunToHalt<AoC::ExecState>(
+      AoC::IntCodeAot{program, image},
+      inputs,
+      [](auto& comp) { return comp.Execute(); });
+  }
+
+  bool Agree(const std::string& name,
+             const AoC::IntCodeAotProgram& program,
+             const std::vector<int64_t>& image,
+             const std::vector<int64_t>& inputs) {
+    if (RunInterpreter(image, inputs) == RunAot(program, image, inputs))
+      return true;
+    std::cout << "Error: compiled code disagrees with the interpreter on "
+              << name << '\n';
+    return false;
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 10;
+    std::vector<int64_t> inputs;
+    for (auto i = 2; i < argc; ++i)
+      inputs.emplace_back(std::stoll(argv[i]));
+    if (inputs.empty())
+      inputs.emplace_back(24);
+
+    const auto& sample = AoC::Aot::aot_sample;
+    const auto& patch  = AoC::Aot::aot_patch;
+    if (!Agree("aot_patch", patch, Image(patch), {}) ||
+        !Agree("a foreign image", sample, Image(patch), {}) ||
+        !Agree("aot_sample", sample, Image(sample), inputs))
+      return 1;
+
+    auto interpreter = [&] { return RunInterpreter(Image(sample), inputs); };
+    auto aot         = [&] { return RunAot(sample, Image(sample), inputs); };
+    auto interpreterStats = AoC::Bench::Measure(interpreter, iterations);
+    auto aotStats         = AoC::Bench::Measure(aot, iterations);
+    AoC::Bench::Print(std::cout, "interpreter", interpreterStats);
+    AoC::Bench::Print(std::cout, "aot", aotStats);
+    std::cout << "Speedup (median): "
+              << interpreterStats.median / aotStats.median << "x\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench/IntCodeBench.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+#include "util/IntCodeBatch.h"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Runs 64 copies of a program one after another on IntCodeComputer, then all
+// at once on IntCodeBatch. Every copy gets the same inputs.
+// Usage: bench_intcode_batch <program> [iterations] [inputs...]
+
+namespace {
+  constexpr size_t lanes = 64;
+
+  using Outputs = std::vector<std::vector<int64_t>>;
+
+  Outputs RunScalar(const AoC::Bench::IntCodeArgs& args) {
+    Outputs ret;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      ret.emplace_back(AoC::Bench::RunToHalt<AoC::ExecState>(
+        AoC::IntCodeComputer{args.program},
+        args.inputs,
+        [](auto& comp) { return comp.Execute(); }));
+    }
+    return ret;
+  }
+
+  Outputs RunBatch(const AoC::Bench::IntCodeArgs& args) {
+    AoC::IntCodeBatch batch{args.program, lanes};
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      for (auto val : args.inputs)
+        batch.PushInput(lane, val);
+    }
+    Outputs ret(lanes);
+    for (bool running = true; running;) {
+      batch.Execute();
+      running = false;
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        if (batch.State(lane) == AoC::ExecState::HAS_OUTPUT) {
+          ret[lane].emplace_back(batch.Out(lane));
+          running = true;
+        }
+      }
+    }
+    return ret;
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    auto args = AoC::Bench::ParseIntCodeArgs(argc, argv);
+    auto scalar = [&] { return RunScalar(args); };
+    auto batch  = [&] { return RunBatch(args); };
+    if (scalar() != batch()) {
+      std::cout << "Error: engines disagree on program output" << '\n';
+      return 1;
+    }
+
+    auto scalarStats = AoC::Bench::Measure(scalar, args.iterations);
+    auto batchStats  = AoC::Bench::Measure(batch, args.iterations);
+    AoC::Bench::Print(std::cout, "scalar x64", scalarStats);
+    AoC::Bench::Print(std::cout, "batch x64", batchStats);
+    std::cout << "Speedup (median): "
+              << scalarStats.median / batchStats.median << "x\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include "util/Bench.h"
+#include "util/IntCode.h"
+#include "util/IntCodeCluster.h"
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A ring of machines passing tokens: each machine reads a token, spins for a
+// while, and sends the token minus one to its neighbour. Tokens die at zero,
+// so the ring goes idle once every token has done its hops, at which point
+// the idle callback starts a second wave. Runs the ring on one worker and on
+// one per core, and checks both against the totals each machine should have
+// accumulated, including once with tiny time slices.
+// Usage: bench_intcode_cluster [iterations] [machines] [hops] [work]
+
+namespace {
+  // in k; loop { in v; if v { acc += v; for i = k; i; acc += --i; out v-1 } }
+  const std::vector<int64_t> node{
+    3,    35, 3,  36, 1006, 36, 2,  1,  37, 36, 37, 101, 0,
+    35,   38, 1001, 38, -1, 38, 1,  37, 38, 37, 1005, 38, 15,
+    1001, 36, -1, 36, 4,  36, 1105, 1,  2,  0,  0,  0,  0};
+  constexpr int64_t accAddr = 37;
+
+  struct Config {
+    size_t machines = 4096;
+    int64_t hops    = 64;
+    int64_t work    = 50;
+  };
+
+  // What each machine's accumulator should hold after two waves.
+  std::vector<int64_t> Expected(const Config& config) {
+    std::vector<int64_t> ret(config.machines);
+    for (size_t start = 0; start < config.machines; ++start) {
+      for (int64_t hop = 0; hop < config.hops; ++hop) {
+        ret[(start + hop) % config.machines] +=
+          2 * (config.hops - hop + config.work * (config.work - 1) / 2);
+      }
+    }
+    return ret;
+  }
+
+  std::vector<int64_t> Run(const Config& config,
+                           size_t threads,
+                           uint64_t slice) {
+    const auto machines = config.machines;
+    AoC::IntCodeCluster<> cluster{
+      1, [&](size_t from, auto packet) {
+        cluster.Send((from + 1) % machines, packet);
+      }};
+    AoC::IntCodeComputer proto{node};
+    for (size_t i = 0; i < machines; ++i)
+      cluster.Send(cluster.Add(proto.Fork()), {config.work, config.hops});
+    bool secondWave = false;
+    cluster.SetIdle([&] {
+      if (std::exchange(secondWave, true))
+        return;
+      for (size_t i = 0; i < machines; ++i)
+        cluster.Send(i, {config.hops});
+    });
+    cluster.SetSlice(slice);
+    cluster.Run(threads);
+
+    std::vector<int64_t> ret;
+    for (size_t i = 0; i < machines; ++i)
+      ret.emplace_back(cluster.Get(i).Peek(accAddr));
+    return ret;
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    size_t iterations = 10;
+    Config config;
+    if (argc > 1)
+      iterations = std::stoul(argv[1]);
+    if (argc > 2)
+      config.machines = std::stoul(argv[2]);
+    if (argc > 3)
+      config.hops = std::stoll(argv[3]);
+    if (argc > 4)
+      config.work = std::stoll(argv[4]);
+    if (!config.machines || config.hops < 1 || config.work < 1)
+      throw std::runtime_error{"Machines, hops and work must be positive"};
+
+    const auto cores    = AoC::WorkerCount(config.machines);
+    const auto expected = Expected(config);
+    // Oversubscribed with tiny slices to shake out races on small machines.
+    const bool correct = Run(config, 1, 10000) == expected &&
+                         Run(config, std::max<size_t>(cores, 4), 10) ==
+                           expected;
+    if (!correct) {
+      std::cout << "Error: cluster produced the wrong totals" << '\n';
+      return 1;
+    }
+
+    auto single = AoC::Bench::Measure([&] { return Run(config, 1, 10000); },
+                                      iterations);
+    auto multi  = AoC::Bench::Measure(
+      [&] { return Run(config, cores, 10000); }, iterations);
+    AoC::Bench::Print(std::cout, "1 worker", single);
+    AoC::Bench::Print(std::cout, std::to_string(cores) + " workers", multi);
+    const auto hops = 2.0 * config.machines * config.hops;
+    std::cout << "Packets per second (" << cores
+              << " workers): " << hops / (multi.median / 1e9) << '\n'
+              << "Speedup (median): " << single.median / multi.median
+              << "x\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
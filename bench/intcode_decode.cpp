@@ -0,0 +1,49 @@
+#include "bench/IntCodeBench.h"
+#include "bench/LegacyIntCode.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Compares the shared pre-decoding engine against the per-day interpreter it
+// replaced. Usage: bench_intcode_decode <program> [iterations] [inputs...]
+
+int main(int argc, const char* argv[]) {
+  try {
+    auto args = AoC::Bench::ParseIntCodeArgs(argc, argv);
+    // The legacy engine needs the 640K of zeroed memory the day 9/11 solvers
+    // used to allocate.
+    std::vector<int64_t> space(std::max<size_t>(81920, args.program.size()));
+    std::copy(args.program.begin(), args.program.end(), space.begin());
+
+    auto legacy = [&] {
+      return AoC::Bench::RunToHalt<Legacy::ExecState>(
+        Legacy::IntCodeComputer{space},
+        args.inputs,
+        [](auto& comp) { return comp.Execute(); });
+    };
+    auto shared = [&] {
+      return AoC::Bench::RunToHalt<AoC::ExecState>(
+        AoC::IntCodeComputer{args.program},
+        args.inputs,
+        [](auto& comp) { return comp.Execute(); });
+    };
+    if (legacy() != shared()) {
+      std::cout << "Error: engines disagree on program output" << '\n';
+      return 1;
+    }
+
+    auto legacyStats = AoC::Bench::Measure(legacy, args.iterations);
+    auto sharedStats = AoC::Bench::Measure(shared, args.iterations);
+    AoC::Bench::Print(std::cout, "legacy (per-insn decode)", legacyStats);
+    AoC::Bench::Print(std::cout, "shared (decode cache)", sharedStats);
+    std::cout << "Speedup (median): " << legacyStats.median / sharedStats.median
+              << "x\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,52 @@
+#include "bench/IntCodeBench.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Compares switch against threaded dispatch. Intended for the day 9 BOOST
+// program in part 2 mode, so the input defaults to 2.
+// Usage: bench_intcode_dispatch <program> [iterations] [inputs...]
+
+int main(int argc, const char* argv[]) {
+  try {
+    auto args = AoC::Bench::ParseIntCodeArgs(argc, argv);
+    if (args.inputs.empty())
+      args.inputs.emplace_back(2);
+
+    auto run = [&](auto exec) {
+      return AoC::Bench::RunToHalt<AoC::ExecState>(
+        AoC::IntCodeComputer{args.program}, args.inputs, exec);
+    };
+    auto switched = [&] {
+      return run([](auto& comp) {
+        return comp.template Execute<AoC::Dispatch::SWITCH>();
+      });
+    };
+    auto threaded = [&] {
+      return run([](auto& comp) {
+        return comp.template Execute<AoC::Dispatch::THREADED>();
+      });
+    };
+    if (switched() != threaded()) {
+      std::cout << "Error: dispatch modes disagree on program output" << '\n';
+      return 1;
+    }
+#ifndef AOC_INTCODE_THREADED_DISPATCH
+    std::cout << "Threaded dispatch unsupported, both runs use the switch\n";
+#endif
+
+    auto switchStats   = AoC::Bench::Measure(switched, args.iterations);
+    auto threadedStats = AoC::Bench::Measure(threaded, args.iterations);
+    AoC::Bench::Print(std::cout, "switch", switchStats);
+    AoC::Bench::Print(std::cout, "threaded", threadedStats);
+    std::cout << "Speedup (median): "
+              << switchStats.median / threadedStats.median << "x\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include "bench/IntCodeBench.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+#include "util/IntCodeJit.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Differential check and benchmark of the JIT against the interpreter. Before
+// timing anything it runs a set of small programs which exercise relative
+// addressing, memory growth and self-modifying code on both engines, then
+// the program under test. Intended for the day 9 BOOST program in part 2
+// mode, so the input defaults to 2.
+// Usage: bench_intcode_jit <program> [iterations] [inputs...]
+
+namespace {
+  struct Case {
+    std::string name;
+    std::vector<int64_t> program;
+    std::vector<int64_t> inputs;
+  };
+
+  const std::vector<Case>& Cases() {
+    static const std::vector<Case> cases{
+      {"compare", {3, 9, 8, 9, 10, 9, 4, 9, 99, -1, 8}, {8}},
+      {"relative",
+       {109, 5000, 21101, 7, 8, 0, 204, 0, 1101, 3, 4, 1000000000, 4,
+        1000000000, 109, -4990, 204, -10, 99},
+       {}},
+      {"quine",
+       {109, 1, 204, -1, 1001, 100, 1, 100, 1008, 100, 16, 101, 1006, 101, 0,
+        99},
+       {}},
+      {"patched operand",
+       {1101, 0, 0, 100, 1001, 100, 1, 100, 1001, 13, 1, 13, 1101, 0, 0, 101,
+        1007, 100, 10, 102, 1005, 102, 4, 4, 101, 99},
+       {}},
+      {"patched opcode", {3, 4, 104, 5, 0, 42, 104, 77, 99}, {104}},
+      // Has instructions the JIT gives up on partway through, after it has
+      // queued jumps to their interpreter stubs.
+      {"abandoned instruction",
+       {20007, 43, 10, 3, 202, 27, 1, 55, 2001, 6, 1, 48, 2106, 52, 40, 6, 7,
+        16, 22108, 25, 22, 1, 104, 7, 20101, 1, 47, 14, 206, 44, 46, 205, 23,
+        29, 1208, 36, 0, 47, 2005, 49, 36, 99, 204, 45, 2006, 48, 16, 208, 28,
+        5, 47, 99},
+       {49, -4, 2, 23}},
+    };
+    return cases;
+  }
+
+  template <class Computer>
+  std::vector<int64_t> Run(const std::vector<int64_t>& program,
+                           const std::vector<int64_t>& inputs) {
+    return AoC::Bench::RunToHalt<AoC::ExecState>(
+      Computer{program}, inputs, [](auto& comp) { return comp.Execute(); });
+  }
+
+  bool Agree(const std::string& name,
+             const std::vector<int64_t>& program,
+             const std::vector<int64_t>& inputs) {
+    if (Run<AoC::IntCodeComputer>(program, inputs) ==
+        Run<AoC::IntCodeJit>(program, inputs))
+      return true;
+    std::cout << "Error: JIT disagrees with the interpreter on " << name
+              << '\n';
+    return false;
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    auto args = AoC::Bench::ParseIntCodeArgs(argc, argv);
+    if (args.inputs.empty())
+      args.inputs.emplace_back(2);
+    if (!AoC::IntCodeJit{args.program}.Native())
+      std::cout << "JIT unsupported, every instruction is interpreted\n";
+    for (auto& test : Cases()) {
+      if (!Agree(test.name, test.program, test.inputs))
+        return 1;
+    }
+    if (!Agree("program", args.program, args.inputs))
+      return 1;
+
+    auto interpreted = [&] {
+      return Run<AoC::IntCodeComputer>(args.program, args.inputs);
+    };
+    auto compiled = [&] {
+      return Run<AoC::IntCodeJit>(args.program, args.inputs);
+    };
+    auto interpreterStats = AoC::Bench::Measure(interpreted, args.iterations);
+    auto jitStats         = AoC::Bench::Measure(compiled, args.iterations);
+    AoC::Bench::Print(std::cout, "interpreter", interpreterStats);
+    AoC::Bench::Print(std::cout, "jit", jitStats);
+    std::cout << "Speedup (median): "
+              << interpreterStats.median / jitStats.median << "x\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
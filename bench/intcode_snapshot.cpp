@@ -0,0 +1,86 @@
+#include "bench/IntCodeBench.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+#include "util/IntCodeSnapshot.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+// Runs a program on the inputs given until it wants more or halts, saves a
+// snapshot of it there, and compares getting back to that point by running
+// the program again against resuming the snapshot. Before timing it checks
+// that the resumed computer carries on exactly like the original when both
+// are given the same inputs again.
+// Usage: bench_intcode_snapshot <program> [iterations] [inputs...]
+
+namespace {
+  constexpr size_t forks = 64;
+
+  AoC::IntCodeComputer WarmUp(const AoC::Bench::IntCodeArgs& args) {
+    AoC::IntCodeComputer comp{args.program};
+    for (auto val : args.inputs)
+      comp.PushInput(val);
+    static_cast<void>(comp.RunUntil(0));
+    return comp;
+  }
+
+  // Everything the computer outputs from here, and how it stops.
+  std::vector<int64_t> Finish(AoC::IntCodeComputer comp,
+                              const std::vector<int64_t>& inputs) {
+    for (auto val : inputs)
+      comp.PushInput(val);
+    const auto state = comp.RunUntil(0);
+    std::vector<int64_t> ret{static_cast<int64_t>(state)};
+    while (comp.OutputCount())
+      ret.emplace_back(comp.PopOutput());
+    return ret;
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    auto args       = AoC::Bench::ParseIntCodeArgs(argc, argv);
+    const auto path = std::filesystem::temp_directory_path() /
+                      "bench_intcode_snapshot.icsnap";
+    AoC::IntCodeSnapshot::Save(WarmUp(args), args.program, path.string());
+
+    {
+      const AoC::IntCodeSnapshot snapshot{path.string()};
+      if (!snapshot.Matches(args.program) ||
+          Finish(WarmUp(args), args.inputs) !=
+            Finish(snapshot.Resume(), args.inputs)) {
+        std::cout << "Error: resumed computer differs from the original"
+                  << '\n';
+        return 1;
+      }
+      std::cout << "Snapshot: " << std::filesystem::file_size(path)
+                << " bytes, " << snapshot.GetHeader().pages << " pages\n";
+
+      auto replay = AoC::Bench::Measure([&] { return WarmUp(args); },
+                                        args.iterations);
+      auto resume = AoC::Bench::Measure(
+        [&] { return AoC::IntCodeSnapshot{path.string()}.Resume(); },
+        args.iterations);
+      auto fork = AoC::Bench::Measure(
+        [&] {
+          std::vector<AoC::IntCodeComputer> comps;
+          for (size_t i = 0; i < forks; ++i)
+            comps.emplace_back(snapshot.Resume());
+          return comps;
+        },
+        args.iterations);
+      AoC::Bench::Print(std::cout, "replay", replay);
+      AoC::Bench::Print(std::cout, "open + resume", resume);
+      AoC::Bench::Print(std::cout, "resume x64", fork);
+      std::cout << "Speedup (median): " << replay.median / resume.median
+                << "x\n";
+    }
+    std::filesystem::remove(path);
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include "bench/IntCodeBench.h"
+#include "util/Bench.h"
+#include "util/IntCode.h"
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Runs one program on computers specialized for different word types and
+// opcode sets: the general int64_t one, int64_t and int32_t without the
+// relative base as days 7 and 5 use, and checked __int128. Every one that
+// can run the program must agree on its output before any are timed. Meant
+// for a day 5 or 7 program, which the narrow computers can run; anything
+// using the relative base or values beyond 32 bits only gets the wide ones.
+// Usage: bench_intcode_width <program> [iterations] [inputs...]
+
+namespace {
+  template <class Spec>
+  std::vector<int64_t> Run(const AoC::Bench::IntCodeArgs& args) {
+    return AoC::Bench::RunToHalt<AoC::ExecState>(
+      AoC::IntCodeMachine<Spec>{args.program}, args.inputs, [](auto& comp) {
+        return comp.Execute();
+      });
+  }
+
+  // Times the spec against the general computer, or says why it can't.
+  template <class Spec>
+  void Compare(const AoC::Bench::IntCodeArgs& args,
+               const std::string& name,
+               const std::vector<int64_t>& expected,
+               const AoC::Bench::Stats& general) {
+    std::optional<std::vector<int64_t>> out;
+    try {
+      out = Run<Spec>(args);
+    } catch (const std::exception& e) {
+      std::cout << name << ": can't run this program (" << e.what() << ")\n";
+      return;
+    }
+    if (*out != expected)
+      throw std::runtime_error{name + " disagrees on program output"};
+    auto stats = AoC::Bench::Measure([&] { return Run<Spec>(args); },
+                                     args.iterations);
+    AoC::Bench::Print(std::cout, name, stats);
+    std::cout << "  vs int64 (median): " << general.median / stats.median
+              << "x\n";
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    const auto args     = AoC::Bench::ParseIntCodeArgs(argc, argv);
+    const auto expected = Run<AoC::IntCodeSpec<>>(args);
+    auto general = AoC::Bench::Measure(
+      [&] { return Run<AoC::IntCodeSpec<>>(args); }, args.iterations);
+    AoC::Bench::Print(std::cout, "int64", general);
+
+    Compare<AoC::IntCodeSpec<int64_t, AoC::IntCodeNarrowSpec::OPS>>(
+      args, "int64 narrow", expected, general);
+    Compare<AoC::IntCodeNarrowSpec>(args, "int32 narrow", expected, general);
+#ifdef __SIZEOF_INT128__
+    Compare<AoC::IntCodeWideSpec>(args, "int128 checked", expected, general);
+#endif
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "util/Bench.h"
+#include "util/Core.h"
+
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compares the two ways solvers read their input on generated files of the
+// given size: comma separated integers through StreamToContainer on an
+// ifstream against ParseDelimited on an InputView, and lines through
+// std::getline against ForEachLine. Both must read the same values.
+// Usage: bench_parse [megabytes] [iterations]
+
+namespace {
+  // Random integers of up to ten digits, either sign, separated by sep.
+  void Generate(const std::filesystem::path& path, size_t bytes, char sep) {
+    std::mt19937_64 rng{42};
+    std::uniform_int_distribution<int64_t> dist{-9999999999, 9999999999};
+    std::string text;
+    text.reserve(bytes + 32);
+    char buf[24];
+    while (text.size() < bytes) {
+      if (!text.empty())
+        text += sep;
+      text.append(buf, std::to_chars(buf, buf + sizeof(buf), dist(rng)).ptr);
+    }
+    std::ofstream file{path, std::ios::binary};
+    if (!file.write(text.data(), text.size()))
+      throw std::runtime_error{"Could not write " + path.string()};
+  }
+
+  // Line totals are stored here so that counting them can't be optimised
+  // away.
+  volatile size_t sink = 0;
+
+  struct LineTotals {
+    size_t lines = 0;
+    size_t chars = 0;
+    bool operator==(const LineTotals&) const = default;
+  };
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    const size_t megabytes  = argc > 1 ? std::stoul(argv[1]) : 256;
+    const size_t iterations = argc > 2 ? std::stoul(argv[2]) : 3;
+    const auto dir          = std::filesystem::temp_directory_path();
+    const auto ints         = (dir / "bench_parse_ints.txt").string();
+    const auto lines        = (dir / "bench_parse_lines.txt").string();
+    Generate(ints, megabytes << 20, ',');
+    Generate(lines, megabytes << 20, '\n');
+
+    using Values = std::vector<int64_t>;
+    auto streamInts = [&] {
+      std::ifstream file{ints};
+      return AoC::StreamToContainer<Values>(file, ',');
+    };
+    auto viewInts = [&] {
+      return AoC::ParseDelimited<Values>(AoC::InputView{ints}.Text(), ',');
+    };
+    auto streamLines = [&] {
+      std::ifstream file{lines};
+      LineTotals ret;
+      for (std::string line; std::getline(file, line); ++ret.lines)
+        ret.chars += line.size();
+      sink = ret.chars;
+      return ret;
+    };
+    auto viewLines = [&] {
+      LineTotals ret;
+      AoC::ForEachLine(AoC::InputView{lines}.Text(),
+                       [&](std::string_view line) {
+                         ++ret.lines;
+                         ret.chars += line.size();
+                       });
+      sink = ret.chars;
+      return ret;
+    };
+    if (streamInts() != viewInts() || streamLines() != viewLines()) {
+      std::cout << "Error: the parsers disagree" << '\n';
+      return 1;
+    }
+
+    auto report = [&](const std::string& name, auto stream, auto view) {
+      const auto streamed = AoC::Bench::Measure(stream, iterations);
+      const auto viewed   = AoC::Bench::Measure(view, iterations);
+      AoC::Bench::Print(std::cout, name + " istream", streamed);
+      AoC::Bench::Print(std::cout, name + " view", viewed);
+      std::cout << "  " << megabytes / (viewed.median / 1e9)
+                << " MB/s, speedup (median): "
+                << streamed.median / viewed.median << "x\n";
+    };
+    report("ints", streamInts, viewInts);
+    report("lines", streamLines, viewLines);
+    std::filesystem::remove(ints);
+    std::filesystem::remove(lines);
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,195 @@
+#include "util/Core.h"
+#include "util/IntCode.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Runs an Intcode program as a filter: input comes from a file or stdin and
+// outputs go to stdout, so it can sit in a pipeline. Integers are read
+// separated by anything that isn't part of one, and written one per line.
+// With --ascii every input byte is a value and outputs below 256 are written
+// as bytes, with anything larger written as a line of its own. Input is
+// read in large blocks straight into one buffer and parsed in place, and
+// output is gathered into another and written a block at a time, or when
+// the program waits for input. The run ends when the program halts or
+// wants input after the input has run out, so a program which loops over
+// its input forever works as a filter too. Errors go to stderr.
+// Usage: intcode <program> [--ascii] [input]
+
+namespace {
+  constexpr size_t BLOCK_SIZE   = size_t{1} << 16;
+  constexpr size_t OUTPUT_CHUNK = 4096;
+
+  [[nodiscard]] std::string Error(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+  }
+
+  class Reader {
+    int fd;
+    bool ascii;
+    std::vector<char> block;
+    // A number cut off by the end of the last block.
+    std::string partial;
+
+    [[nodiscard]] static bool InNumber(char c) {
+      return (c >= '0' && c <= '9') || c == '-';
+    }
+
+    static void Push(AoC::IntCodeComputer& comp,
+                     const char* first,
+                     const char* last) {
+      int64_t val    = 0;
+      auto [ptr, ec] = std::from_chars(first, last, val);
+      if (ec != std::errc{} || ptr != last)
+        throw std::runtime_error{"Bad input value " +
+                                 std::string(first, last)};
+      comp.PushInput(val);
+    }
+
+    // Pushes every number in the block, keeping one which runs off the end.
+    size_t Parse(AoC::IntCodeComputer& comp,
+                 const char* pos,
+                 const char* end) {
+      size_t ret = 0;
+      while (pos < end) {
+        const auto* start = pos;
+        while (pos < end && InNumber(*pos))
+          ++pos;
+        if (pos == end) {
+          partial.append(start, end);
+          break;
+        }
+        if (!partial.empty()) {
+          partial.append(start, pos);
+          Push(comp, partial.data(), partial.data() + partial.size());
+          partial.clear();
+          ++ret;
+        } else if (pos != start) {
+          Push(comp, start, pos);
+          ++ret;
+        }
+        ++pos;
+      }
+      return ret;
+    }
+
+   public:
+    Reader(int fd, bool ascii) : fd{fd}, ascii{ascii}, block(BLOCK_SIZE) {}
+
+    // Reads until at least one input has been pushed to comp. False if the
+    // input ran out first.
+    bool Feed(AoC::IntCodeComputer& comp) {
+      while (true) {
+        const auto got = read(fd, block.data(), block.size());
+        if (got < 0 && errno == EINTR)
+          continue;
+        if (got < 0)
+          throw std::runtime_error{Error("Could not read input")};
+        if (got == 0) {
+          if (partial.empty())
+            return false;
+          Push(comp, partial.data(), partial.data() + partial.size());
+          partial.clear();
+          return true;
+        }
+        if (ascii) {
+          for (ssize_t i = 0; i < got; ++i)
+            comp.PushInput(static_cast<unsigned char>(block[i]));
+          return true;
+        }
+        if (Parse(comp, block.data(), block.data() + got))
+          return true;
+      }
+    }
+  };
+
+  class Writer {
+    int fd;
+    bool ascii;
+    std::vector<char> block;
+    size_t used = 0;
+
+   public:
+    Writer(int fd, bool ascii) : fd{fd}, ascii{ascii}, block(BLOCK_SIZE) {}
+
+    void Put(int64_t val) {
+      // Room for any int64_t and its newline.
+      if (block.size() - used < 21)
+        Flush();
+      if (ascii && val >= 0 && val < 256) {
+        block[used++] = static_cast<char>(val);
+        return;
+      }
+      auto* pos = block.data() + used;
+      pos       = std::to_chars(pos, block.data() + block.size(), val).ptr;
+      *pos++    = '\n';
+      used      = pos - block.data();
+    }
+
+    void Flush() {
+      for (size_t done = 0; done < used;) {
+        const auto sent = write(fd, block.data() + done, used - done);
+        if (sent < 0 && errno != EINTR)
+          throw std::runtime_error{Error("Could not write output")};
+        done += sent > 0 ? sent : 0;
+      }
+      used = 0;
+    }
+  };
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    std::vector<std::string> args{argv + 1, argv + argc};
+    bool ascii = false;
+    if (args.size() > 1 && args[1] == "--ascii") {
+      ascii = true;
+      args.erase(args.begin() + 1);
+    }
+    if (args.empty() || args.size() > 2)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <program> [--ascii] [input]"};
+    std::ifstream file{args[0]};
+    const auto program =
+      AoC::StreamToContainer<std::vector<int64_t>>(file, ',');
+    if (program.empty())
+      throw std::runtime_error{"Could not read program"};
+
+    int fd = STDIN_FILENO;
+    if (args.size() == 2 && args[1] != "-") {
+      fd = open(args[1].c_str(), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error{Error("Could not open " + args[1])};
+    }
+    Reader in{fd, ascii};
+    Writer out{STDOUT_FILENO, ascii};
+    AoC::IntCodeComputer comp{program};
+    while (true) {
+      const auto state = comp.RunUntil(OUTPUT_CHUNK);
+      while (comp.OutputCount())
+        out.Put(comp.PopOutput());
+      if (state == AoC::ExecState::HALTED)
+        break;
+      if (state == AoC::ExecState::NEED_INPUT) {
+        // Whoever is feeding us may be waiting on this before sending more.
+        out.Flush();
+        if (!in.Feed(comp))
+          break;
+      }
+    }
+    out.Flush();
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "util/Core.h"
+#include "util/IntCode.h"
+#include "util/IntCodeAnalysis.h"
+#include "util/IntCodeProfile.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Disassembles an Intcode program into basic blocks, lists the
+// superinstructions the loader installs for it, then runs it with and
+// without them to count how many dispatches they save. The runs stop early
+// if the program wants more input than was given.
+// Usage: intcode_analyze <program> [inputs...]
+
+namespace {
+  uint64_t Dispatches(const std::vector<int64_t>& program,
+                      const std::vector<int64_t>& inputs,
+                      AoC::Fusion fusion,
+                      std::array<uint64_t, AoC::Insn::HANDLERS>& counts) {
+    AoC::BasicIntCodeComputer<AoC::IntCodeProfiler> comp{program, fusion};
+    for (auto val : inputs)
+      comp.PushInput(val);
+    static_cast<void>(comp.RunUntil(0));
+    for (size_t i = 0; i < counts.size(); ++i)
+      counts[i] = comp.GetTrace().Opcode(static_cast<AoC::Insn::Handler>(i));
+    return comp.GetTrace().Insns().Total();
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    if (argc < 2)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <program> [inputs...]"};
+    std::ifstream file{argv[1]};
+    const auto program =
+      AoC::StreamToContainer<std::vector<int64_t>>(file, ',');
+    if (program.empty())
+      throw std::runtime_error{"Could not read program"};
+    std::vector<int64_t> inputs;
+    for (auto i = 2; i < argc; ++i)
+      inputs.emplace_back(std::stoll(argv[i]));
+
+    const AoC::IntCodeCfg cfg{program};
+    size_t insns = 0, edges = 0, indirect = 0;
+    for (auto& block : cfg.Blocks()) {
+      auto last = block.begin;
+      for (auto pos = block.begin; pos < block.end; pos += cfg.Length(pos)) {
+        last = pos;
+        ++insns;
+      }
+      const AoC::Insn op{program[last]};
+      indirect += AoC::IsJump(op.GetHandler()) &&
+                  op.ParamB() != AoC::ParamMode::IMMEDIATE;
+      edges += block.next.size();
+    }
+    std::cout << "Image: " << program.size() << " words, " << insns
+              << " instructions in " << cfg.Blocks().size()
+              << " basic blocks, " << edges << " known edges, " << indirect
+              << " indirect jumps\n";
+
+    std::array<size_t, AoC::Insn::HANDLERS> sites{};
+    for (auto& fusion : AoC::FindFusions(cfg))
+      ++sites[fusion.op.GetHandler()];
+    std::array<uint64_t, AoC::Insn::HANDLERS> plain{}, fused{};
+    const auto before = Dispatches(program, inputs, AoC::Fusion::OFF, plain);
+    const auto after  = Dispatches(program, inputs, AoC::Fusion::ON, fused);
+    std::cout << "Superinstructions (sites, times run):\n";
+    for (size_t i = AoC::Insn::UNKNOWN + 1; i < sites.size(); ++i) {
+      std::cout << "  "
+                << AoC::HandlerName(static_cast<AoC::Insn::Handler>(i))
+                << ": " << sites[i] << ", " << fused[i] << '\n';
+    }
+    std::cout << "Dispatches: " << before << " -> " << after;
+    if (before)
+      std::cout << " (" << 100.0 * (before - after) / before << "% fewer)";
+    std::cout << '\n';
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,255 @@
+#include "util/Core.h"
+#include "util/IntCodeAnalysis.h"
+#include "util/IntCodeInsn.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Translates an Intcode program to C++ for IntCodeAot: one label per
+// instruction, with every operand mode resolved here and memory accessed
+// directly. Writes <name>.h and <name>.cpp to <output-dir>, declaring
+// AoC::Aot::<name>.
+// Usage: intcode_aot <program> <name> <output-dir>
+
+namespace {
+  [[nodiscard]] std::string Literal(int64_t val) {
+    if (val == INT64_MIN)
+      return "INT64_MIN";
+    return "int64_t{" + std::to_string(val) + "}";
+  }
+
+  class Translator {
+    const std::vector<int64_t>& image;
+    const AoC::IntCodeCfg cfg;
+    std::ostringstream body;
+    bool usesInput  = false;
+    bool usesOutput = false;
+    bool usesHalt   = false;
+
+    [[nodiscard]] int64_t Size() const {
+      return static_cast<int64_t>(image.size());
+    }
+
+    [[nodiscard]] bool InImage(int64_t pos) const {
+      return pos >= 0 && pos < Size();
+    }
+
+    [[nodiscard]] std::string Arg(int64_t pos, AoC::ParamMode mode) const {
+      const auto word = image[pos];
+      switch (mode) {
+      case AoC::ParamMode::POSITION:
+        if (InImage(word))
+          return "ctx.Word(" + std::to_string(word) + ")";
+        return "ctx.Load(" + Literal(word) + ")";
+      case AoC::ParamMode::IMMEDIATE:
+        return Literal(word);
+      case AoC::ParamMode::RELATIVE:
+        return "ctx.Load(rel + " + Literal(word) + ")";
+      }
+      return {};
+    }
+
+    void Goto(int64_t target) {
+      if (cfg.Length(target))
+        body << "  goto L" << target << ";\n";
+      else
+        body << "  ip = " << Literal(target) << ";\n  goto dispatch;\n";
+    }
+
+    // Writes val to the destination operand at pos. Overwriting compiled
+    // code leaves for the interpreter at next.
+    void Store(int64_t pos,
+               AoC::ParamMode mode,
+               const std::string& val,
+               int64_t next) {
+      const auto word = image[pos];
+      const auto exit =
+        "ip = " + std::to_string(next) + ";\n    goto interpret;\n";
+      switch (mode) {
+      case AoC::ParamMode::POSITION:
+        if (InImage(word) && !cfg.IsCode(word)) {
+          body << "  ctx.Word(" << word << ") = " << val << ";\n";
+        } else if (!InImage(word)) {
+          body << "  ctx.Store(" << Literal(word) << ", " << val << ");\n";
+        } else {
+          body << "  {\n    ctx.Store(" << word << ", " << val << ");\n    "
+               << exit << "  }\n";
+        }
+        break;
+      case AoC::ParamMode::IMMEDIATE:
+        body << "  {\n    ctx.Store(" << pos << ", " << val << ");\n    "
+             << exit << "  }\n";
+        break;
+      case AoC::ParamMode::RELATIVE:
+        body << "  if (ctx.Store(rel + " << Literal(word) << ", " << val
+             << ")) {\n    " << exit << "  }\n";
+        break;
+      }
+    }
+
+    // Returns whether execution can fall through to the next word.
+    bool Emit(int64_t pos) {
+      const AoC::Insn op{image[pos]};
+      const auto next = pos + cfg.Length(pos);
+      body << "L" << pos << ":\n"
+           << "  if (ctx.Stale(" << pos << ")) {\n"
+           << "    ip = " << pos << ";\n    goto interpret;\n  }\n";
+      switch (op.GetHandler()) {
+      case AoC::Insn::ADD:
+      case AoC::Insn::MULTIPLY:
+      case AoC::Insn::LESS_THAN:
+      case AoC::Insn::EQUALS: {
+        const char* oper = op.GetHandler() == AoC::Insn::ADD        ? " + "
+                           : op.GetHandler() == AoC::Insn::MULTIPLY ? " * "
+                           : op.GetHandler() == AoC::Insn::LESS_THAN
+                             ? " < "
+                             : " == ";
+        const auto val = "int64_t{" + Arg(pos + 1, op.ParamA()) + oper +
+                         Arg(pos + 2, op.ParamB()) + "}";
+        Store(pos + 3, op.ParamC(), val, next);
+        return true;
+      }
+      case AoC::Insn::INPUT:
+        usesInput = true;
+        body << "  if (ctx.InputEmpty()) {\n    ip = " << pos
+             << ";\n    goto needInput;\n  }\n";
+        Store(pos + 1, op.ParamA(), "ctx.PopInput()", next);
+        return true;
+      case AoC::Insn::OUTPUT:
+        usesOutput = true;
+        body << "  if (ctx.Output(" << Arg(pos + 1, op.ParamA())
+             << ")) {\n    ip = " << next << ";\n    goto hasOutput;\n  }\n";
+        return true;
+      case AoC::Insn::JUMP_IF_TRUE:
+      case AoC::Insn::JUMP_IF_FALSE: {
+        const bool ifTrue = op.GetHandler() == AoC::Insn::JUMP_IF_TRUE;
+        if (op.ParamA() == AoC::ParamMode::IMMEDIATE) {
+          if ((image[pos + 1] != 0) != ifTrue)
+            return true;
+        } else {
+          body << "  if (" << Arg(pos + 1, op.ParamA())
+               << (ifTrue ? " != 0" : " == 0") << ")\n";
+        }
+        body << "  {\n";
+        if (op.ParamB() == AoC::ParamMode::IMMEDIATE) {
+          Goto(image[pos + 2]);
+        } else {
+          body << "  ip = " << Arg(pos + 2, op.ParamB())
+               << ";\n  goto dispatch;\n";
+        }
+        body << "  }\n";
+        return op.ParamA() != AoC::ParamMode::IMMEDIATE;
+      }
+      case AoC::Insn::ADJUST_REL_PTR:
+        body << "  rel += " << Arg(pos + 1, op.ParamA()) << ";\n";
+        return true;
+      default:
+        usesHalt = true;
+        body << "  ip = " << pos << ";\n  goto halted;\n";
+        return false;
+      }
+    }
+
+    void EmitExit(std::ostream& out, const char* label, const char* state) {
+      out << label << ":\n"
+          << "  ctx.InsnPtr() = ip;\n  ctx.RelPtr()  = rel;\n"
+          << "  return " << state << ";\n";
+    }
+
+   public:
+    explicit Translator(const std::vector<int64_t>& image)
+        : image{image}, cfg{image} {}
+
+    void WriteHeader(std::ostream& out, const std::string& name) const {
+      out << "// Generated by intcode_aot. Do not edit.\n"
+          << "#ifndef AOC_AOT_" << name << "\n#define AOC_AOT_" << name
+          << "\n\n#include \"util/IntCodeAot.h\"\n\n"
+          << "namespace AoC::Aot {\n"
+          << "  extern const IntCodeAotProgram " << name << ";\n"
+          << "} // namespace AoC::Aot\n\n#endif // AOC_AOT_" << name << '\n';
+    }
+
+    void WriteSource(std::ostream& out, const std::string& name) {
+      for (int64_t pos = 0; pos < Size(); ++pos) {
+        if (!cfg.Length(pos))
+          continue;
+        const bool fallsThrough = Emit(pos);
+        const auto next         = pos + cfg.Length(pos);
+        auto following          = next;
+        while (following < Size() && !cfg.Length(following))
+          ++following;
+        if (fallsThrough && following != next)
+          Goto(next);
+      }
+
+      out << "// Generated by intcode_aot. Do not edit.\n"
+          << "#include \"aot/" << name << ".h\"\n\n"
+          << "#include <cstdint>\n#include <iterator>\n#include <optional>\n\n"
+          << "namespace AoC::Aot {\n  namespace {\n"
+          << "    const int64_t image[] = {";
+      for (size_t i = 0; i < image.size(); ++i)
+        out << (i % 8 ? " " : "\n      ")
+            << (image[i] == INT64_MIN ? "INT64_MIN"
+                                      : std::to_string(image[i]))
+            << ',';
+      out << "\n    };\n\n    const uint8_t lengths[] = {";
+      for (int64_t pos = 0; pos < Size(); ++pos)
+        out << (pos % 16 ? " " : "\n      ") << cfg.Length(pos) << ',';
+      out << "\n    };\n\n"
+          << "    std::optional<ExecState> Run(IntCodeAotContext& ctx) {\n"
+          << "      int64_t ip  = ctx.InsnPtr();\n"
+          << "      int64_t rel = ctx.RelPtr();\n"
+          << "      goto dispatch;\n"
+          << "      // clang-format off\n"
+          << body.str() << "  ip = " << Size() << ";\n"
+          << "dispatch:\n  switch (ip) {\n";
+      for (int64_t pos = 0; pos < Size(); ++pos) {
+        if (cfg.Length(pos))
+          out << "  case " << pos << ": goto L" << pos << ";\n";
+      }
+      out << "  default: goto interpret;\n  }\n";
+      EmitExit(out, "interpret", "std::nullopt");
+      if (usesInput)
+        EmitExit(out, "needInput", "ExecState::NEED_INPUT");
+      if (usesOutput)
+        EmitExit(out, "hasOutput", "ExecState::HAS_OUTPUT");
+      if (usesHalt)
+        EmitExit(out, "halted", "ExecState::HALTED");
+      out << "      // clang-format on\n    }\n  } // namespace\n\n"
+          << "  const IntCodeAotProgram " << name
+          << "{image, std::size(image), lengths, Run};\n"
+          << "} // namespace AoC::Aot\n";
+    }
+  };
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    if (argc != 4)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <program> <name> <output-dir>"};
+    std::ifstream file{argv[1]};
+    const auto image =
+      AoC::StreamToContainer<std::vector<int64_t>>(file, ',');
+    if (image.empty())
+      throw std::runtime_error{"Could not read program"};
+    const std::string name = argv[2];
+    const std::string dir  = argv[3];
+
+    Translator translator{image};
+    std::ofstream header{dir + "/" + name + ".h"};
+    translator.WriteHeader(header, name);
+    std::ofstream source{dir + "/" + name + ".cpp"};
+    translator.WriteSource(source, name);
+    if (!header || !source)
+      throw std::runtime_error{"Could not write output"};
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+#include "util/IntCodeAsm.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+// Assembles Intcode (see util/IntCodeAsm.h for the syntax) and writes the
+// program as comma separated words, to stdout unless an output file is
+// given.
+// Usage: intcode_asm <source> [output]
+
+int main(int argc, const char* argv[]) {
+  try {
+    if (argc < 2 || argc > 3)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <source> [output]"};
+    std::ifstream in{argv[1]};
+    if (!in)
+      throw std::runtime_error{std::string{"Could not open "} + argv[1]};
+    const std::string source{std::istreambuf_iterator<char>{in}, {}};
+    const auto image = AoC::IntCodeAssemble(source);
+
+    std::string text;
+    for (auto word : image) {
+      if (!text.empty())
+        text += ',';
+      text += std::to_string(word);
+    }
+    if (argc == 2) {
+      std::cout << text << '\n';
+    } else {
+      std::ofstream out{argv[2]};
+      if (!(out << text))
+        throw std::runtime_error{std::string{"Could not write "} + argv[2]};
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
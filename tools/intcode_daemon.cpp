@@ -0,0 +1,255 @@
+#include "util/IntCode.h"
+#include "util/IntCodeDaemon.h"
+#include "util/IntCodeSnapshot.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Serves Intcode programs over a Unix socket, see util/IntCodeDaemon.h for
+// the protocol. Programs are cached by content hash as a loaded computer,
+// and each keeps a pool of VMs which are reset by copying the loaded one
+// over them, so a request allocates nothing once the pool is warm. At most
+// --cache programs are kept, dropping the least recently started, and a
+// RUN executes at most --budget instructions so that a program which never
+// stops can't hold a connection's thread forever. Every connection gets a
+// thread.
+// Usage: intcode_daemon <socket> [--pool N] [--cache N] [--budget N]
+
+namespace {
+  using Computer = AoC::IntCodeComputer;
+
+  class Program {
+    const Computer loaded;
+    std::mutex lock;
+    std::vector<std::unique_ptr<Computer>> idle;
+
+   public:
+    const std::vector<int64_t> image;
+    // When the program was last loaded or started, by the daemon's clock.
+    std::atomic<uint64_t> lastUsed{0};
+
+    Program(const std::vector<int64_t>& image, size_t pool)
+        : loaded{image}, image{image} {
+      for (size_t i = 0; i < pool; ++i)
+        idle.emplace_back(std::make_unique<Computer>(loaded));
+    }
+
+    // A VM in the program's initial state.
+    [[nodiscard]] std::unique_ptr<Computer> Acquire() {
+      std::unique_ptr<Computer> ret;
+      {
+        std::lock_guard guard{lock};
+        if (!idle.empty()) {
+          ret = std::move(idle.back());
+          idle.pop_back();
+        }
+      }
+      if (!ret)
+        return std::make_unique<Computer>(loaded);
+      *ret = loaded;
+      return ret;
+    }
+
+    void Release(std::unique_ptr<Computer> comp) {
+      std::lock_guard guard{lock};
+      idle.emplace_back(std::move(comp));
+    }
+  };
+
+  struct Options {
+    size_t pool     = 4;
+    size_t cache    = 64;
+    uint64_t budget = 100'000'000;
+  };
+
+  class Daemon {
+    Options options;
+    std::shared_mutex lock;
+    std::unordered_map<uint64_t, std::shared_ptr<Program>> programs;
+    std::atomic<uint64_t> clock{0};
+
+    void Touch(Program& program) { program.lastUsed = ++clock; }
+
+    // Makes room for one more program. Sessions running an evicted program
+    // keep it alive until they end.
+    void Evict() {
+      while (!programs.empty() && programs.size() >= options.cache) {
+        auto oldest = programs.begin();
+        for (auto iter = programs.begin(); iter != programs.end(); ++iter) {
+          if (iter->second->lastUsed < oldest->second->lastUsed)
+            oldest = iter;
+        }
+        programs.erase(oldest);
+      }
+    }
+
+    [[nodiscard]] uint64_t Load(const std::vector<int64_t>& image) {
+      const auto hash = AoC::IntCodeImageHash(image);
+      {
+        std::shared_lock guard{lock};
+        if (auto iter = programs.find(hash); iter != programs.end()) {
+          if (iter->second->image != image)
+            throw std::runtime_error{"Program hash collision"};
+          Touch(*iter->second);
+          return hash;
+        }
+      }
+      // Built outside the lock, since analysing a big program takes a while.
+      auto program = std::make_shared<Program>(image, options.pool);
+      Touch(*program);
+      std::unique_lock guard{lock};
+      if (!programs.contains(hash)) {
+        Evict();
+        programs.emplace(hash, std::move(program));
+      }
+      return hash;
+    }
+
+    [[nodiscard]] std::shared_ptr<Program> Find(uint64_t hash) {
+      std::shared_lock guard{lock};
+      auto iter = programs.find(hash);
+      if (iter == programs.end())
+        throw std::runtime_error{"Unknown program"};
+      Touch(*iter->second);
+      return iter->second;
+    }
+
+    // One connection's VM, handed back to its program's pool when done.
+    struct Session {
+      std::shared_ptr<Program> program;
+      std::unique_ptr<Computer> comp;
+
+      void End() {
+        if (comp)
+          program->Release(std::move(comp));
+        program.reset();
+      }
+      ~Session() { End(); }
+    };
+
+    int64_t Handle(Session& session,
+                   int64_t type,
+                   const std::vector<int64_t>& payload,
+                   std::vector<int64_t>& reply) {
+      switch (static_cast<AoC::IntCodeRequest>(type)) {
+      case AoC::IntCodeRequest::LOAD:
+        if (payload.empty())
+          throw std::runtime_error{"Empty program"};
+        reply.emplace_back(static_cast<int64_t>(Load(payload)));
+        return AoC::INTCODE_REPLY_OK;
+      case AoC::IntCodeRequest::START:
+        session.End();
+        session.program = Find(static_cast<uint64_t>(payload.at(0)));
+        session.comp    = session.program->Acquire();
+        return AoC::INTCODE_REPLY_OK;
+      case AoC::IntCodeRequest::RUN: {
+        if (!session.comp)
+          throw std::runtime_error{"No program started"};
+        auto& comp = *session.comp;
+        for (auto val : payload)
+          comp.PushInput(val);
+        auto budget      = options.budget;
+        const auto state = comp.RunFor(budget, AoC::INTCODE_OUTPUT_CHUNK);
+        while (comp.OutputCount())
+          reply.emplace_back(comp.PopOutput());
+        return state ? static_cast<int64_t>(*state)
+                     : AoC::INTCODE_REPLY_BUDGET;
+      }
+      }
+      throw std::runtime_error{"Unknown request " + std::to_string(type)};
+    }
+
+   public:
+    explicit Daemon(const Options& options) : options{options} {}
+
+    void Serve(AoC::IntCodeSocket sock) {
+      Session session;
+      std::vector<int64_t> payload;
+      std::vector<int64_t> reply;
+      try {
+        for (int64_t type = 0; sock.Receive(type, payload);) {
+          reply.clear();
+          int64_t status = 0;
+          try {
+            status = Handle(session, type, payload, reply);
+          } catch (const std::exception& e) {
+            // A VM that threw is in no state to be reused.
+            session.comp.reset();
+            session.End();
+            const std::string what = e.what();
+            reply.assign(what.begin(), what.end());
+            status = AoC::INTCODE_REPLY_ERROR;
+          }
+          sock.Send(status, reply);
+        }
+      } catch (const std::exception& e) {
+        std::cerr << "Connection dropped: " << e.what() << '\n';
+      }
+    }
+  };
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    const auto usage = std::string{"Usage: "} + argv[0] +
+                       " <socket> [--pool N] [--cache N] [--budget N]";
+    if (argc < 2 || argc % 2)
+      throw std::runtime_error{usage};
+    const std::string path = argv[1];
+    Options options;
+    for (auto i = 2; i < argc; i += 2) {
+      const std::string arg = argv[i];
+      if (arg == "--pool")
+        options.pool = std::stoul(argv[i + 1]);
+      else if (arg == "--cache")
+        options.cache = std::stoul(argv[i + 1]);
+      else if (arg == "--budget")
+        options.budget = std::stoull(argv[i + 1]);
+      else
+        throw std::runtime_error{usage};
+    }
+    if (!options.cache || !options.budget)
+      throw std::runtime_error{"Cache size and budget must be positive"};
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+      throw std::runtime_error{"Socket path too long"};
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0)
+      throw std::runtime_error{"Could not listen on " + path};
+    std::cout << "Listening on " << path << std::endl;
+
+    Daemon daemon{options};
+    while (true) {
+      const int client = accept(fd, nullptr, nullptr);
+      if (client < 0)
+        continue;
+      std::thread{[&daemon, client] {
+        daemon.Serve(AoC::IntCodeSocket{client});
+      }}.detach();
+    }
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,131 @@
+#include "util/Bench.h"
+#include "util/Core.h"
+#include "util/IntCode.h"
+#include "util/IntCodeDaemon.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A load generator for intcode_daemon. Each client connects once, loads the
+// program, then runs it to completion requests times on a fresh VM, checking
+// every result against a local run. Reports throughput and per-request
+// latency, next to the latency of running the program on a fresh computer
+// in-process.
+// Usage: intcode_load <socket> <program> [--clients N] [--requests N]
+//                     [inputs...]
+
+namespace {
+  struct Options {
+    std::string socket;
+    std::vector<int64_t> program;
+    std::vector<int64_t> inputs;
+    size_t clients  = 4;
+    size_t requests = 1000;
+  };
+
+  Options Parse(int argc, const char* argv[]) {
+    if (argc < 3)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <socket> <program> [--clients N]"
+                               " [--requests N] [inputs...]"};
+    Options ret;
+    ret.socket = argv[1];
+    std::ifstream file{argv[2]};
+    ret.program = AoC::StreamToContainer<std::vector<int64_t>>(file, ',');
+    if (ret.program.empty())
+      throw std::runtime_error{"Could not read program"};
+    for (auto i = 3; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--clients" && i + 1 < argc)
+        ret.clients = std::stoul(argv[++i]);
+      else if (arg == "--requests" && i + 1 < argc)
+        ret.requests = std::stoul(argv[++i]);
+      else
+        ret.inputs.emplace_back(std::stoll(arg));
+    }
+    return ret;
+  }
+
+  std::vector<int64_t> RunLocal(const Options& options) {
+    AoC::IntCodeComputer comp{options.program};
+    for (auto val : options.inputs)
+      comp.PushInput(val);
+    static_cast<void>(comp.RunUntil(0));
+    std::vector<int64_t> ret;
+    while (comp.OutputCount())
+      ret.emplace_back(comp.PopOutput());
+    return ret;
+  }
+
+  // Request latencies in nanoseconds.
+  std::vector<double> Client(const Options& options,
+                             const std::vector<int64_t>& expected) {
+    AoC::IntCodeClient client{options.socket};
+    const auto hash = client.Load(options.program);
+    std::vector<double> ret;
+    ret.reserve(options.requests);
+    std::vector<int64_t> outputs;
+    for (size_t i = 0; i < options.requests; ++i) {
+      ret.emplace_back(AoC::Bench::TimeOnce([&] {
+        outputs.clear();
+        client.Start(hash);
+        auto state = client.Run(options.inputs, outputs);
+        while (!state || *state == AoC::ExecState::HAS_OUTPUT)
+          state = client.Run({}, outputs);
+      }));
+      if (outputs != expected)
+        throw std::runtime_error{"Daemon output differs from a local run"};
+    }
+    return ret;
+  }
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    const auto options  = Parse(argc, argv);
+    const auto expected = RunLocal(options);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::vector<double>> latencies(options.clients);
+    std::vector<std::exception_ptr> errors(options.clients);
+    const auto wall = AoC::Bench::TimeOnce([&] {
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < options.clients; ++i) {
+        threads.emplace_back([&, i] {
+          try {
+            latencies[i] = Client(options, expected);
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+        });
+      }
+      for (auto& thread : threads)
+        thread.join();
+    });
+    for (auto& error : errors) {
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+    std::vector<double> all;
+    for (auto& samples : latencies)
+      all.insert(all.end(), samples.begin(), samples.end());
+    const auto local = AoC::Bench::Measure([&] { return RunLocal(options); },
+                                           options.requests);
+    AoC::Bench::Print(std::cout, "daemon request", AoC::Bench::Summarise(all));
+    AoC::Bench::Print(std::cout, "in-process", local);
+    std::cout << "Throughput: " << all.size() / (wall / 1e9)
+              << " requests/s over " << options.clients << " clients\n";
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
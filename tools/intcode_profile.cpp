@@ -0,0 +1,65 @@
+#include "util/Core.h"
+#include "util/IntCode.h"
+#include "util/IntCodeProfile.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Runs an Intcode program to completion under IntCodeProfiler and prints
+// where it spent its time. Stops early if the program wants more input than
+// was given. --trace also writes a binary trace of every instruction.
+// Usage: intcode_profile <program> [--top N] [--trace <file>] [inputs...]
+
+int main(int argc, const char* argv[]) {
+  try {
+    if (argc < 2)
+      throw std::runtime_error{std::string{"Usage: "} + argv[0] +
+                               " <program> [--top N] [--trace <file>] "
+                               "[inputs...]"};
+    std::ifstream file{argv[1]};
+    const auto program =
+      AoC::StreamToContainer<std::vector<int64_t>>(file, ',');
+    if (program.empty())
+      throw std::runtime_error{"Could not read program"};
+
+    // Declared first so that it outlives the profiler, which flushes into
+    // it when destroyed, even if the run throws.
+    std::ofstream trace;
+    // Superinstructions would hide the instructions they stand for.
+    AoC::BasicIntCodeComputer<AoC::IntCodeProfiler> comp{program,
+                                                         AoC::Fusion::OFF};
+    size_t top = 10;
+    for (auto i = 2; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if ((arg == "--top" || arg == "--trace") && i + 1 == argc)
+        throw std::runtime_error{arg + " needs a value"};
+      if (arg == "--top") {
+        top = std::stoul(argv[++i]);
+      } else if (arg == "--trace") {
+        trace.open(argv[++i], std::ios::binary);
+        if (!trace)
+          throw std::runtime_error{"Could not open trace file"};
+        comp.GetTrace().Stream(trace);
+      } else {
+        comp.PushInput(std::stoll(arg));
+      }
+    }
+
+    const auto state = comp.RunUntil(0);
+    comp.GetTrace().Flush();
+    std::cout << "Outputs:";
+    while (comp.OutputCount())
+      std::cout << ' ' << comp.PopOutput();
+    std::cout << '\n'
+              << (state == AoC::ExecState::HALTED ? "Halted" : "Needs input")
+              << '\n';
+    comp.GetTrace().Report(std::cout, top);
+  } catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef AOC_UTIL_ALLOC
+#define AOC_UTIL_ALLOC
+
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/resource.h>
+#endif
+
+// Heap accounting through the global operator new and delete in
+// util/AllocHook.cpp, which CMake links into the days, defining
+// AOC_ALLOC_STATS, when configured with -DAOC_ALLOC_STATS=ON. Without it
+// every count reads as zero and ENABLED is false.
+namespace AoC::Alloc {
+  struct Stats {
+    uint64_t allocations = 0;
+    // Bytes asked for, ignoring the allocator's own overhead.
+    uint64_t bytes = 0;
+    uint64_t live  = 0;
+    // Most bytes live at once since the last ResetPeak().
+    uint64_t peak = 0;
+  };
+
+#ifdef AOC_ALLOC_STATS
+  inline constexpr bool ENABLED = true;
+
+  [[nodiscard]] Stats Read() noexcept;
+  void ResetPeak() noexcept;
+#else
+  inline constexpr bool ENABLED = false;
+
+  [[nodiscard]] inline Stats Read() noexcept { return {}; }
+  inline void ResetPeak() noexcept {}
+#endif
+
+  // The most the process has had resident so far in KiB, or 0 if unknown.
+  [[nodiscard]] inline uint64_t PeakRssKiB() noexcept {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+#  ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#  else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#  endif
+#else
+    return 0;
+#endif
+  }
+} // namespace AoC::Alloc
+
+#endif // AOC_UTIL_ALLOC
@@ -0,0 +1,98 @@
+#include "util/Alloc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete to keep the counts in
+// util/Alloc.h. Each block starts with a header holding its size, so
+// delete knows how much is going away without the allocator's help.
+// The nothrow forms aren't replaced: the library's versions call these.
+
+namespace {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> live{0};
+  std::atomic<uint64_t> peak{0};
+
+  // Keeps malloc's alignment for what follows the header.
+  constexpr size_t HEADER = alignof(std::max_align_t);
+
+  void Count(size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    const auto now = live.fetch_add(size, std::memory_order_relaxed) + size;
+    auto high      = peak.load(std::memory_order_relaxed);
+    while (now > high && !peak.compare_exchange_weak(high, now)) {
+    }
+  }
+
+  // header bytes, a multiple of align, come before the returned pointer,
+  // with the size in the last few of them.
+  void* Allocate(size_t size, size_t align, size_t header) {
+    const auto total = (size + header + align - 1) / align * align;
+    void* block      = align > HEADER ? std::aligned_alloc(align, total)
+                                      : std::malloc(size + header);
+    if (!block)
+      throw std::bad_alloc{};
+    auto* ret = static_cast<char*>(block) + header;
+    reinterpret_cast<size_t*>(ret)[-1] = size;
+    Count(size);
+    return ret;
+  }
+
+  void Free(void* ptr, size_t header) noexcept {
+    if (!ptr)
+      return;
+    auto* block = static_cast<char*>(ptr) - header;
+    live.fetch_sub(reinterpret_cast<size_t*>(ptr)[-1],
+                   std::memory_order_relaxed);
+    std::free(block);
+  }
+
+  size_t AlignedHeader(std::align_val_t align) {
+    return std::max(static_cast<size_t>(align), HEADER);
+  }
+} // namespace
+
+namespace AoC::Alloc {
+  Stats Read() noexcept {
+    return {allocations.load(std::memory_order_relaxed),
+            bytes.load(std::memory_order_relaxed),
+            live.load(std::memory_order_relaxed),
+            peak.load(std::memory_order_relaxed)};
+  }
+
+  void ResetPeak() noexcept {
+    peak.store(live.load(std::memory_order_relaxed),
+               std::memory_order_relaxed);
+  }
+} // namespace AoC::Alloc
+
+void* operator new(size_t size) { return Allocate(size, HEADER, HEADER); }
+void* operator new[](size_t size) { return Allocate(size, HEADER, HEADER); }
+void operator delete(void* ptr) noexcept { Free(ptr, HEADER); }
+void operator delete[](void* ptr) noexcept { Free(ptr, HEADER); }
+void operator delete(void* ptr, size_t) noexcept { Free(ptr, HEADER); }
+void operator delete[](void* ptr, size_t) noexcept { Free(ptr, HEADER); }
+
+void* operator new(size_t size, std::align_val_t align) {
+  return Allocate(size, static_cast<size_t>(align), AlignedHeader(align));
+}
+void* operator new[](size_t size, std::align_val_t align) {
+  return Allocate(size, static_cast<size_t>(align), AlignedHeader(align));
+}
+void operator delete(void* ptr, std::align_val_t align) noexcept {
+  Free(ptr, AlignedHeader(align));
+}
+void operator delete[](void* ptr, std::align_val_t align) noexcept {
+  Free(ptr, AlignedHeader(align));
+}
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept {
+  Free(ptr, AlignedHeader(align));
+}
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept {
+  Free(ptr, AlignedHeader(align));
+}
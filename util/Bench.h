@@ -0,0 +1,65 @@
+#ifndef AOC_UTIL_BENCH
+#define AOC_UTIL_BENCH
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace AoC::Bench {
+  // Wall times in nanoseconds.
+  struct Stats {
+    double min     = 0;
+    double median  = 0;
+    double p99     = 0;
+    size_t samples = 0;
+  };
+
+  [[nodiscard]] inline Stats Summarise(std::vector<double> samples) {
+    Stats ret;
+    if (samples.empty())
+      return ret;
+    std::sort(samples.begin(), samples.end());
+    ret.samples = samples.size();
+    ret.min     = samples.front();
+    ret.median  = samples[samples.size() / 2];
+    ret.p99     = samples[(samples.size() - 1) * 99 / 100];
+    return ret;
+  }
+
+  template <class Func>
+  [[nodiscard]] double TimeOnce(Func&& func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+  }
+
+  template <class Func>
+  [[nodiscard]] Stats Measure(Func&& func,
+                              size_t iterations,
+                              size_t warmup = 1) {
+    for (size_t i = 0; i < warmup; ++i)
+      func();
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i = 0; i < iterations; ++i)
+      samples.emplace_back(TimeOnce(func));
+    return Summarise(std::move(samples));
+  }
+
+  inline void Print(std::ostream& out,
+                    const std::string& name,
+                    const Stats& stats) {
+    out << std::left << std::setw(24) << name << std::right << std::fixed
+        << std::setprecision(3) << " min " << std::setw(12)
+        << stats.min / 1e6 << "ms  median " << std::setw(12)
+        << stats.median / 1e6 << "ms  p99 " << std::setw(12)
+        << stats.p99 / 1e6 << "ms  (" << stats.samples << " runs)\n";
+  }
+} // namespace AoC::Bench
+
+#endif // AOC_UTIL_BENCH
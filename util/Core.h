@@ -1,20 +1,47 @@
 #ifndef AOC_UTIL_CORE
 #define AOC_UTIL_CORE
 
+#include "util/Alloc.h"
+#include "util/Bench.h"
+#include "util/Perf.h"
+
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
 #include <istream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <type_traits>
 
+#if defined(__unix__) || defined(__APPLE__)
+#  define AOC_CORE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 namespace AoC {
   template <typename Part1Result_t, typename Part2Result_t>
   class Solver {
    public:
     using Results = std::pair<Part1Result_t, Part2Result_t>;
+    // Redeclared as true by a solver whose public SolvePart1() and
+    // SolvePart2() share no mutable state, letting AoC::main run them on
+    // separate threads.
+    static constexpr bool INDEPENDENT_PARTS = false;
     [[nodiscard]] virtual Results Solve() = 0;
   };
 
@@ -36,6 +63,123 @@ namespace AoC {
       func(elem);
   }
 
+  // A whole input file, mapped read-only where the platform has mmap and
+  // read into memory otherwise. Solvers constructible from one are given
+  // it by main() instead of a stream, and parse the text in place with the
+  // helpers below rather than through locale-aware stream extraction.
+  class InputView {
+    std::shared_ptr<const char> data;
+    size_t size = 0;
+
+   public:
+    explicit InputView(const std::string& path) {
+#ifdef AOC_CORE_MMAP
+      const int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error{"Could not open " + path};
+      struct stat info {};
+      if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error{"Could not read " + path};
+      }
+      size = static_cast<size_t>(info.st_size);
+      if (size == 0) {
+        close(fd);
+        return;
+      }
+      void* mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (mem == MAP_FAILED)
+        throw std::runtime_error{"Could not map " + path};
+      madvise(mem, size, MADV_SEQUENTIAL);
+      data = std::shared_ptr<const char>{
+        static_cast<const char*>(mem), [len = size](const char* ptr) {
+          munmap(const_cast<char*>(ptr), len);
+        }};
+#else
+      std::ifstream file{path, std::ios::binary | std::ios::ate};
+      if (!file)
+        throw std::runtime_error{"Could not open " + path};
+      size = static_cast<size_t>(file.tellg());
+      std::shared_ptr<char[]> buf{new char[size]};
+      file.seekg(0);
+      if (!file.read(buf.get(), size))
+        throw std::runtime_error{"Could not read " + path};
+      data = std::shared_ptr<const char>{buf, buf.get()};
+#endif
+    }
+
+    [[nodiscard]] std::string_view Text() const noexcept {
+      return {data.get(), size};
+    }
+  };
+
+  [[nodiscard]] constexpr bool IsSpace(char c) noexcept {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  // Parses the whole of text as a number, throwing if it isn't one.
+  template <typename T>
+  [[nodiscard]] T ParseNumber(std::string_view text) {
+    T ret{};
+    const auto* end = text.data() + text.size();
+    auto [ptr, ec]  = std::from_chars(text.data(), end, ret);
+    if (ec != std::errc{} || ptr != end)
+      throw std::runtime_error{"Bad number in input: " + std::string{text}};
+    return ret;
+  }
+
+  // The from_chars counterpart of StreamToContainer: reads a number, skips
+  // to just past the next delim, and repeats. Whitespace before a number is
+  // skipped, and anything else where one should be throws.
+  template <typename Container>
+  [[nodiscard]] Container ParseDelimited(std::string_view text,
+                                         char delim = '\n') {
+    Container ret;
+    const auto* pos = text.data();
+    const auto* end = pos + text.size();
+    while (true) {
+      pos = std::find_if_not(pos, end, IsSpace);
+      if (pos == end)
+        return ret;
+      typename Container::value_type val{};
+      auto [ptr, ec] = std::from_chars(pos, end, val);
+      if (ec != std::errc{})
+        throw std::runtime_error{"Bad number in input at offset " +
+                                 std::to_string(pos - text.data())};
+      ret.emplace_back(val);
+      pos = std::find(ptr, end, delim);
+      if (pos != end)
+        ++pos;
+    }
+  }
+
+  // Calls func with each line of text, without its line ending. A final
+  // newline doesn't start another line.
+  template <class LineFunction>
+  void ForEachLine(std::string_view text, LineFunction func) {
+    while (!text.empty()) {
+      const auto eol = std::min(text.find('\n'), text.size());
+      auto line      = text.substr(0, eol);
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      func(line);
+      text.remove_prefix(std::min(eol + 1, text.size()));
+    }
+  }
+
+  // Calls func(x, y, c) for every character c of a grid given as lines of
+  // text.
+  template <class CellFunction>
+  void ForEachCell(std::string_view text, CellFunction func) {
+    size_t y = 0;
+    ForEachLine(text, [&](std::string_view line) {
+      for (size_t x = 0; x < line.size(); ++x)
+        func(x, y, line[x]);
+      ++y;
+    });
+  }
+
   template <typename T, size_t... Is>
   constexpr std::array<T, sizeof...(Is)> make_array(
     const T& v,
@@ -48,6 +192,279 @@ namespace AoC {
     return make_array(t, std::make_index_sequence<N>());
   }
 
+  // A solver whose parts can be run separately, through public
+  // SolvePart1() and SolvePart2() members, has them timed separately by
+  // --bench. Any other is timed as a whole through Solve().
+  template <typename Solver_t>
+  concept SplitSolver = requires(Solver_t& solver) {
+    solver.SolvePart1();
+    solver.SolvePart2();
+  };
+
+  template <typename Solver_t>
+  concept ConcurrentSolver =
+    SplitSolver<Solver_t> && Solver_t::INDEPENDENT_PARTS;
+
+  // Solves both parts, part 2 on a thread of its own if they are
+  // independent. Either way the results come back as a pair in part order,
+  // and an exception from either part is rethrown once both have stopped.
+  template <typename Solver_t>
+  [[nodiscard]] typename Solver_t::Results SolveAll(Solver_t& solver) {
+    if constexpr (ConcurrentSolver<Solver_t>) {
+      auto part2 =
+        std::async(std::launch::async, [&] { return solver.SolvePart2(); });
+      auto part1 = solver.SolvePart1();
+      return {std::move(part1), part2.get()};
+    } else {
+      return solver.Solve();
+    }
+  }
+
+  // Builds a solver from the input file, as an InputView if it takes one,
+  // and calls func with it.
+  template <typename Solver_t, class Func>
+  void WithSolver(const std::string& path,
+                  std::vector<std::string> args,
+                  Func func) {
+    if constexpr (std::is_constructible_v<Solver_t,
+                                          const InputView&,
+                                          std::vector<std::string>>) {
+      const InputView input{path};
+      Solver_t solver{input, std::move(args)};
+      func(solver);
+    } else {
+      std::ifstream file{path};
+      Solver_t solver{file, std::move(args)};
+      func(solver);
+    }
+  }
+
+  template <typename Part1, typename Part2>
+  void PrintAnswers(const Part1& part1, const Part2& part2) {
+    std::cout << "Part1 Answer: ";
+    if constexpr (!std::is_arithmetic_v<Part1>)
+      std::cout << '\n';
+    std::cout << part1 << '\n';
+    std::cout << "Part2 Answer: ";
+    if constexpr (!std::is_arithmetic_v<Part2>)
+      std::cout << '\n';
+    std::cout << part2 << '\n';
+  }
+
+  struct BenchOptions {
+    size_t runs = 0;
+    // Where to write JSON, if anywhere, with "-" for stdout.
+    std::string json;
+    // Whether to count hardware events as well, see util/Perf.h.
+    bool counters = false;
+    // Most heap allocations a solve may make, when built with
+    // AOC_ALLOC_STATS.
+    std::optional<uint64_t> allocBudget;
+  };
+
+  // A phase of a --bench run, with its wall times in nanoseconds and, if
+  // they are being counted, its hardware event totals. Its heap use, with
+  // peak as the most live at once, and the peak RSS of the process by its
+  // end come from the warm up run.
+  struct BenchPhase {
+    std::string name;
+    std::vector<double> samples;
+    Perf::Sample counters{};
+    Alloc::Stats alloc{};
+    uint64_t peakRss = 0;
+
+    explicit BenchPhase(std::string name) : name{std::move(name)} {}
+  };
+
+  // Measures a phase at a time: its wall time, and its event counts if
+  // given counters. Stop() adds them to phase, except during the warm up,
+  // when it records the phase's heap use instead.
+  class PhaseTimer {
+    Perf::Counters* counters;
+    std::chrono::steady_clock::time_point start;
+    Alloc::Stats heap;
+
+   public:
+    bool warmUp = true;
+
+    explicit PhaseTimer(Perf::Counters* counters) : counters{counters} {}
+
+    void Start() {
+      if constexpr (Alloc::ENABLED) {
+        Alloc::ResetPeak();
+        heap = Alloc::Read();
+      }
+      if (counters)
+        counters->Start();
+      start = std::chrono::steady_clock::now();
+    }
+
+    void Stop(BenchPhase& phase) {
+      const auto end    = std::chrono::steady_clock::now();
+      const auto counts = counters ? counters->Stop() : Perf::Sample{};
+      if (warmUp) {
+        const auto now = Alloc::Read();
+        phase.alloc    = {now.allocations - heap.allocations,
+                          now.bytes - heap.bytes, now.live, now.peak};
+        phase.peakRss  = Alloc::PeakRssKiB();
+        return;
+      }
+      phase.samples.emplace_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+      for (size_t i = 0; i < counts.size(); ++i)
+        phase.counters[i] += counts[i];
+    }
+
+    template <class Func>
+    decltype(auto) Time(BenchPhase& phase, Func func) {
+      Start();
+      decltype(auto) ret = func();
+      Stop(phase);
+      return ret;
+    }
+  };
+
+  inline void PrintHeapUse(std::ostream& out, const BenchPhase& phase) {
+    out << std::left << std::setw(24) << phase.name << std::right << ' '
+        << phase.alloc.allocations << " allocations, " << phase.alloc.bytes
+        << " bytes, peak live " << phase.alloc.peak << " bytes, peak RSS "
+        << phase.peakRss << " KiB\n";
+  }
+
+  inline void WriteBenchJson(std::ostream& out,
+                             const std::vector<BenchPhase>& phases,
+                             const Perf::Counters* counters,
+                             size_t runs) {
+    out << std::fixed << std::setprecision(0) << "{\"runs\": " << runs
+        << ", \"phases\": [";
+    for (size_t i = 0; i < phases.size(); ++i) {
+      out << (i ? ", " : "") << "{\"name\": \"" << phases[i].name << '"';
+      if (runs) {
+        const auto stats = Bench::Summarise(phases[i].samples);
+        out << ", \"min_ns\": " << stats.min
+            << ", \"median_ns\": " << stats.median
+            << ", \"p99_ns\": " << stats.p99;
+      }
+      if constexpr (Alloc::ENABLED) {
+        const auto& alloc = phases[i].alloc;
+        out << ", \"allocations\": " << alloc.allocations
+            << ", \"alloc_bytes\": " << alloc.bytes
+            << ", \"peak_live_bytes\": " << alloc.peak
+            << ", \"peak_rss_kib\": " << phases[i].peakRss;
+      }
+      if (counters && runs) {
+        // Per run averages, like the text output.
+        out << ", \"counters\": {";
+        const char* sep = "";
+        for (size_t event = 0; event < Perf::EVENT_COUNT; ++event) {
+          if (!counters->Available(event))
+            continue;
+          out << sep << '"' << Perf::EVENT_NAMES[event] << "\": "
+              << static_cast<double>(phases[i].counters[event]) / runs;
+          sep = ", ";
+        }
+        out << '}';
+      }
+      out << '}';
+    }
+    out << "]}\n";
+  }
+
+  // --bench: builds and solves the input once to warm up, then runs times
+  // more, timing construction (which is where input is parsed) and each
+  // part. Every run must give the answers the first did. Prints the
+  // answers and a summary of each phase, and writes the summary as JSON if
+  // asked to. Without hardware counters it says so and carries on timing.
+  // With AOC_ALLOC_STATS the warm up's heap use is shown per phase too, and
+  // runs may be 0 for just that; going over the allocation budget throws
+  // once everything has been reported. Parts are timed one at a time, even
+  // where AoC::main would run them at once.
+  template <typename Solver_t>
+  void Benchmark(const std::string& path,
+                 const std::vector<std::string>& args,
+                 const BenchOptions& options) {
+    std::vector<BenchPhase> phases;
+    phases.emplace_back("parse");
+    if constexpr (SplitSolver<Solver_t>) {
+      phases.emplace_back("part1");
+      phases.emplace_back("part2");
+    } else {
+      phases.emplace_back("solve");
+    }
+    std::optional<Perf::Counters> perf;
+    Perf::Counters* counters = nullptr;
+    if (options.counters) {
+      perf.emplace();
+      if (perf->Available())
+        counters = &*perf;
+      else
+        std::cout << "Hardware counters unavailable (" << perf->Reason()
+                  << ")\n";
+    }
+
+    using Results = typename Solver_t::Results;
+    std::optional<Results> first;
+    PhaseTimer timer{counters};
+    for (size_t run = 0; run <= options.runs; ++run) {
+      timer.warmUp = run == 0;
+      Results results;
+      timer.Start();
+      WithSolver<Solver_t>(path, args, [&](Solver_t& solver) {
+        timer.Stop(phases[0]);
+        if constexpr (SplitSolver<Solver_t>) {
+          auto part1 = [&] { return solver.SolvePart1(); };
+          auto part2 = [&] { return solver.SolvePart2(); };
+          results    = {timer.Time(phases[1], part1),
+                        timer.Time(phases[2], part2)};
+        } else {
+          results = timer.Time(phases[1], [&] { return solver.Solve(); });
+        }
+      });
+      if (!first)
+        first = std::move(results);
+      else if (results != *first)
+        throw std::runtime_error{"Answers changed between benchmark runs"};
+    }
+    PrintAnswers(first->first, first->second);
+
+    if constexpr (Alloc::ENABLED) {
+      std::cout << "Heap use:\n";
+      for (auto& phase : phases)
+        PrintHeapUse(std::cout, phase);
+    }
+    if (options.runs) {
+      std::cout << "Benchmark (" << options.runs
+                << " runs after a warm up):\n";
+      for (auto& phase : phases) {
+        Bench::Print(std::cout, phase.name, Bench::Summarise(phase.samples));
+        if (counters)
+          Perf::Print(std::cout, *counters, phase.counters, options.runs);
+      }
+    }
+    if (!options.json.empty()) {
+      std::ofstream file;
+      if (options.json != "-")
+        file.open(options.json);
+      auto& out = options.json == "-" ? std::cout : file;
+      WriteBenchJson(out, phases, counters, options.runs);
+      if (!out)
+        throw std::runtime_error{"Could not write " + options.json};
+    }
+    if (options.allocBudget) {
+      uint64_t allocations = 0;
+      for (auto& phase : phases)
+        allocations += phase.alloc.allocations;
+      if (allocations > *options.allocBudget)
+        throw std::runtime_error{
+          std::to_string(allocations) + " allocations is over the budget of " +
+          std::to_string(*options.allocBudget)};
+    }
+  }
+
+  // Solves the input file given as the first argument and prints the
+  // answers. Every other argument is passed on to the solver, except for
+  // --bench N, which times N runs (see Benchmark()), --json <file>,
+  // --counters and --alloc-budget N.
   template <typename Solver_t>
   [[nodiscard]] static int main(const int argc, const char* argv[]) {
     if (argc < 2) {
@@ -56,24 +473,40 @@ namespace AoC {
                 << '\n';
       return -2;
     }
-    std::vector<std::string> extraArgs;
-    if (argc - 2 > 0) {
-      extraArgs.reserve(argc - 2);
-      for (auto i = 2; i < argc; ++i)
-        extraArgs.emplace_back(argv[i]);
-    }
     try {
-      std::ifstream file{argv[1]};
-      Solver_t solver{file, std::move(extraArgs)};
-      auto&& [part1, part2] = solver.Solve();
-      std::cout << "Part1 Answer: ";
-      if constexpr (!std::is_arithmetic_v<decltype(part1)>)
-        std::cout << '\n';
-      std::cout << part1 << '\n';
-      std::cout << "Part2 Answer: ";
-      if constexpr (!std::is_arithmetic_v<decltype(part2)>)
-        std::cout << '\n';
-      std::cout << part2 << '\n';
+      std::vector<std::string> extraArgs;
+      BenchOptions bench;
+      for (auto i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "--bench" || arg == "--json" || arg == "--alloc-budget") &&
+            i + 1 == argc)
+          throw std::runtime_error{arg + " needs a value"};
+        if (arg == "--bench")
+          bench.runs = std::stoul(argv[++i]);
+        else if (arg == "--json")
+          bench.json = argv[++i];
+        else if (arg == "--counters")
+          bench.counters = true;
+        else if (arg == "--alloc-budget")
+          bench.allocBudget = std::stoull(argv[++i]);
+        else
+          extraArgs.emplace_back(arg);
+      }
+      // Heap use is reported without --bench, so may be written as JSON.
+      if (!bench.runs && (bench.counters || (!bench.json.empty() &&
+                                             !Alloc::ENABLED)))
+        throw std::runtime_error{"--json and --counters need --bench N"};
+      if (bench.allocBudget && !Alloc::ENABLED)
+        throw std::runtime_error{"--alloc-budget needs a build configured "
+                                 "with -DAOC_ALLOC_STATS=ON"};
+      if (bench.runs || Alloc::ENABLED) {
+        Benchmark<Solver_t>(argv[1], extraArgs, bench);
+        return 0;
+      }
+      WithSolver<Solver_t>(argv[1], std::move(extraArgs), [](auto& solver) {
+        auto&& [part1, part2] = SolveAll(solver);
+        PrintAnswers(part1, part2);
+      });
     } catch (const std::exception& e) {
       std::cout << "Error: " << e.what() << '\n';
       return 1;
@@ -0,0 +1,953 @@
+#ifndef AOC_UTIL_INTCODE
+#define AOC_UTIL_INTCODE
+
+#include "util/IntCodeAnalysis.h"
+#include "util/IntCodeInsn.h"
+#include "util/RingBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__)
+// GCC and Clang support labels-as-values, which the threaded dispatch needs.
+#  define AOC_INTCODE_THREADED_DISPATCH
+#endif
+
+namespace AoC {
+  template <class Word, int64_t Words>
+  struct IntCodePage {
+    std::array<Word, Words> words{};
+    std::array<Insn, Words> decoded{};
+  };
+
+  // Intcode memory, allocated a page at a time on first write. Reading memory
+  // which was never written returns 0 without allocating anything, so any
+  // non-negative address is valid. Pages near the program image are found by
+  // indexing a flat directory; pages past DIRECTORY_LIMIT live in a hash map.
+  // Each page carries the decode cache for its words.
+  //
+  // Pages may be shared between the memories produced by Fork(). A shared
+  // page is copied by whichever memory first writes to it.
+  //
+  // Words are of type Word, though addresses are always int64_t and program
+  // images are read as int64_t. A program word which doesn't fit in Word is
+  // rejected when the memory is built.
+  template <class Word>
+  class BasicIntCodeMemory {
+   public:
+    static constexpr int64_t PAGE_BITS       = 10;
+    static constexpr int64_t PAGE_WORDS      = 1 << PAGE_BITS;
+    static constexpr int64_t PAGE_MASK       = PAGE_WORDS - 1;
+    static constexpr int64_t DIRECTORY_LIMIT = 1 << 16;
+
+    using Page = IntCodePage<Word, PAGE_WORDS>;
+
+   private:
+    // directory[i] points at pages[i], or at ZeroPage() if page i has never
+    // been written, so reads never need a null check. writable[i] is the same
+    // page if this memory is its only owner, and null otherwise.
+    std::vector<Page*> directory;
+    std::vector<Page*> writable;
+    std::vector<std::shared_ptr<Page>> pages;
+    std::unordered_map<int64_t, std::shared_ptr<Page>> sparse;
+
+    // Backs every unwritten page. It is never written to.
+    static inline Page zeroPage{};
+    static Page* ZeroPage() noexcept { return &zeroPage; }
+
+    [[nodiscard]] Page* Find(int64_t addr) const {
+      const auto idx = static_cast<uint64_t>(addr) >> PAGE_BITS;
+      return idx < directory.size() ? directory[idx] : FindSparse(addr);
+    }
+
+    [[nodiscard, gnu::noinline]] Page* FindSparse(int64_t addr) const {
+      if (addr < 0)
+        throw std::out_of_range{"Negative Intcode address"};
+      auto iter = sparse.find(addr >> PAGE_BITS);
+      return iter == sparse.end() ? ZeroPage() : iter->second.get();
+    }
+
+    // The page holding addr if it may be written in place, otherwise null.
+    [[nodiscard]] Page* Writable(int64_t addr) const {
+      const auto idx = static_cast<uint64_t>(addr) >> PAGE_BITS;
+      return idx < writable.size() ? writable[idx] : nullptr;
+    }
+
+    std::shared_ptr<Page>& Slot(int64_t addr) {
+      if (addr < 0)
+        throw std::out_of_range{"Negative Intcode address"};
+      const auto idx = addr >> PAGE_BITS;
+      if (idx >= DIRECTORY_LIMIT)
+        return sparse[idx];
+      if (idx >= static_cast<int64_t>(directory.size())) {
+        directory.resize(idx + 1, ZeroPage());
+        writable.resize(idx + 1);
+        pages.resize(idx + 1);
+      }
+      return pages[idx];
+    }
+
+    // Words too wide for an int64_t can't be opcodes.
+    static Insn DecodeWord(Word word) {
+      if constexpr (sizeof(Word) > sizeof(int64_t)) {
+        if (word < INT64_MIN || word > INT64_MAX)
+          return Insn{-1};
+      }
+      return Insn{static_cast<int64_t>(word)};
+    }
+
+    // Makes the page holding addr private to this memory, allocating it if it
+    // was never written and copying it if it is shared.
+    [[gnu::noinline]] Page& Fault(int64_t addr) {
+      auto& slot = Slot(addr);
+      if (!slot)
+        slot = std::make_shared<Page>();
+      else if (slot.use_count() > 1)
+        slot = std::make_shared<Page>(*slot);
+      if (const auto idx = addr >> PAGE_BITS; idx < DIRECTORY_LIMIT)
+        directory[idx] = writable[idx] = slot.get();
+      return *slot;
+    }
+
+    // Like Writable(), but also reclaims pages whose other owners are gone.
+    [[nodiscard]] Page* Owned(int64_t addr) {
+      if (auto* page = Writable(addr))
+        return page;
+      if (Find(addr) == ZeroPage() || Slot(addr).use_count() > 1)
+        return nullptr;
+      return &Fault(addr);
+    }
+
+   public:
+    BasicIntCodeMemory() = default;
+    BasicIntCodeMemory(BasicIntCodeMemory&&) noexcept = default;
+    BasicIntCodeMemory& operator=(BasicIntCodeMemory&&) noexcept = default;
+    // Copies are deep, since the source cannot be marked as shared through a
+    // const reference. Use Fork() to share pages instead. Assigning over a
+    // memory reuses the pages it owns rather than allocating new ones.
+    BasicIntCodeMemory(const BasicIntCodeMemory& rhs) { *this = rhs; }
+    BasicIntCodeMemory& operator=(const BasicIntCodeMemory& rhs) {
+      if (this == &rhs)
+        return *this;
+      const auto size = rhs.pages.size();
+      directory.resize(size);
+      writable.resize(size);
+      pages.resize(size);
+      for (size_t i = 0; i < size; ++i) {
+        if (!rhs.pages[i]) {
+          pages[i].reset();
+          directory[i] = ZeroPage();
+          writable[i]  = nullptr;
+          continue;
+        }
+        if (writable[i])
+          *writable[i] = *rhs.pages[i];
+        else
+          pages[i] = std::make_shared<Page>(*rhs.pages[i]);
+        directory[i] = writable[i] = pages[i].get();
+      }
+      sparse.clear();
+      for (auto& [idx, page] : rhs.sparse)
+        sparse.emplace(idx, std::make_shared<Page>(*page));
+      return *this;
+    }
+
+    explicit BasicIntCodeMemory(const std::vector<int64_t>& image) {
+      for (size_t i = 0; i < image.size(); i += PAGE_WORDS) {
+        auto& page     = Fault(i);
+        const auto len = std::min<size_t>(PAGE_WORDS, image.size() - i);
+        for (size_t j = 0; j < len; ++j) {
+          page.words[j] = static_cast<Word>(image[i + j]);
+          if (page.words[j] != image[i + j])
+            throw std::out_of_range{"Intcode program word out of range"};
+        }
+      }
+    }
+
+    // A memory sharing every page with this one. Both sides copy a page
+    // before their first write to it, so forking costs one pointer per page.
+    [[nodiscard]] BasicIntCodeMemory Fork() {
+      std::fill(writable.begin(), writable.end(), nullptr);
+      BasicIntCodeMemory ret;
+      ret.directory = directory;
+      ret.writable.resize(writable.size());
+      ret.pages  = pages;
+      ret.sparse = sparse;
+      return ret;
+    }
+
+    [[nodiscard]] Word Read(int64_t addr) const {
+      return Find(addr)->words[addr & PAGE_MASK];
+    }
+
+    // Writes drop the cached decode of the word they overwrite, which keeps
+    // self-modifying programs correct.
+    void Write(int64_t addr, Word val) {
+      auto* page = Writable(addr);
+      if (!page)
+        page = &Fault(addr);
+      page->words[addr & PAGE_MASK]   = val;
+      page->decoded[addr & PAGE_MASK] = Insn{};
+    }
+
+    // The page holding addr. Unwritten pages all share one page of zeroes.
+    [[nodiscard]] const Page* PageOf(int64_t addr) const { return Find(addr); }
+
+    // Decodes the word at addr, caching the result unless the page is shared
+    // with another memory.
+    [[gnu::noinline]] Insn Decode(int64_t addr) {
+      auto* page = Owned(addr);
+      if (!page)
+        return DecodeWord(Read(addr));
+      return page->decoded[addr & PAGE_MASK] =
+               DecodeWord(page->words[addr & PAGE_MASK]);
+    }
+
+    // Caches op as the decode at addr in place of what Decode() would give.
+    // Like Decode(), leaves pages shared with another memory alone.
+    void Install(int64_t addr, Insn op) {
+      if (auto* page = Owned(addr))
+        page->decoded[addr & PAGE_MASK] = op;
+    }
+
+    // Calls func(index, page) for every page allocated, where index is the
+    // address of its first word divided by PAGE_WORDS.
+    template <class Func>
+    void ForEachPage(Func func) const {
+      for (size_t i = 0; i < pages.size(); ++i) {
+        if (pages[i])
+          func(static_cast<int64_t>(i), *pages[i]);
+      }
+      for (auto& [idx, page] : sparse)
+        func(idx, *page);
+    }
+
+    // Puts page in at index as a shared page, as if it had been forked from
+    // another memory. It is copied before the first write unless this memory
+    // turns out to be its last owner.
+    void Share(int64_t index, std::shared_ptr<Page> page) {
+      if (index < 0 || index > (INT64_MAX >> PAGE_BITS))
+        throw std::out_of_range{"Intcode page index out of range"};
+      auto& slot = Slot(index << PAGE_BITS);
+      slot       = std::move(page);
+      if (index < DIRECTORY_LIMIT) {
+        directory[index] = slot.get();
+        writable[index]  = nullptr;
+      }
+    }
+
+    // Number of pages allocated so far, including shared ones.
+    [[nodiscard]] size_t Pages() const noexcept {
+      size_t ret = sparse.size();
+      for (auto& page : pages)
+        ret += page != nullptr;
+      return ret;
+    }
+  };
+
+  using IntCodeMemory = BasicIntCodeMemory<int64_t>;
+
+  // The default trace policy of an Intcode computer, which records nothing.
+  // A policy implements these hooks, which the computer calls as it runs:
+  // OnInsn for every instruction dispatched, OnJump for every jump taken,
+  // OnRead and OnWrite for every data access through an operand, and
+  // OnRelPtr whenever the relative base moves. With this one they are all
+  // empty and inline, so they compile to nothing.
+  struct IntCodeNoTrace {
+    static constexpr bool ENABLED = false;
+    void OnInsn(int64_t, Insn, int64_t) noexcept {}
+    void OnJump(int64_t, int64_t) noexcept {}
+    void OnRead(int64_t) noexcept {}
+    void OnWrite(int64_t) noexcept {}
+    void OnRelPtr(int64_t, int64_t) noexcept {}
+  };
+
+  // Whether a computer built from a program image runs the loader pass
+  // which installs superinstructions. Off by default: on bench_intcode's
+  // corpus fusion only pays off for the call heavy fib workload, and slows
+  // sort, hash and echo down.
+  enum class Fusion { ON, OFF };
+
+  // Groups of opcodes and parameter modes a computer can be built with, on
+  // top of add, multiply, halt and position mode which it always has.
+  namespace IntCodeOps {
+    constexpr unsigned IO        = 1 << 0; // input and output
+    constexpr unsigned BRANCH    = 1 << 1; // jumps and comparisons
+    constexpr unsigned IMMEDIATE = 1 << 2; // immediate mode
+    constexpr unsigned RELATIVE  = 1 << 3; // relative mode and its base
+    constexpr unsigned ALL       = IO | BRANCH | IMMEDIATE | RELATIVE;
+  } // namespace IntCodeOps
+
+  // What a computer is specialized for: the type of a memory word, the
+  // IntCodeOps it supports, and whether add and multiply throw
+  // std::overflow_error rather than wrapping around in two's complement.
+  // Handlers for anything left out are compiled out of the dispatch loop,
+  // and a program that uses it throws when the instruction is reached.
+  template <class WordType = int64_t,
+            unsigned Ops   = IntCodeOps::ALL,
+            bool Checked   = false>
+  struct IntCodeSpec {
+    using Word                    = WordType;
+    static constexpr unsigned OPS = Ops;
+    static constexpr bool CHECKED = Checked;
+  };
+
+  // Day 2's programs only add and multiply, and days 5 and 7 have no
+  // relative base. Day 2 wraps at 64 bits like IntCodeBatch and its
+  // symbolic solver, so that all three give the same answer for any noun
+  // and verb. Day 5 fits in 32 bits, and is checked so that a program which
+  // doesn't fails rather than giving a wrong answer.
+  using IntCodeArithmeticSpec = IntCodeSpec<int64_t, 0>;
+  using IntCodeNarrowSpec =
+    IntCodeSpec<int32_t,
+                IntCodeOps::IO | IntCodeOps::BRANCH | IntCodeOps::IMMEDIATE,
+                true>;
+#ifdef __SIZEOF_INT128__
+  // For programs whose values might outgrow 64 bits.
+  using IntCodeWideSpec = IntCodeSpec<__int128, IntCodeOps::ALL, true>;
+#endif
+
+  class IntCodeSnapshot;
+
+  template <class Trace = IntCodeNoTrace, class Spec = IntCodeSpec<>>
+  class BasicIntCodeComputer {
+    friend class IntCodeSnapshot;
+
+   public:
+    using Word = typename Spec::Word;
+
+   private:
+    using Memory = BasicIntCodeMemory<Word>;
+
+    static constexpr bool FULL = Spec::OPS == IntCodeOps::ALL;
+
+    Memory mem;
+    const typename Memory::Page* insnPage = nullptr;
+    RingBuffer<Word> input;
+    RingBuffer<Word> output;
+    size_t outputsWanted = 1;
+    int64_t insnPtr      = 0;
+    int64_t relPtr       = 0;
+    Word out             = 0;
+    uint64_t budget      = 0;
+    [[no_unique_address]] Trace trace;
+
+    [[nodiscard]] static constexpr bool Has(unsigned ops) noexcept {
+      return (Spec::OPS & ops) == ops;
+    }
+
+    [[nodiscard]] static constexpr bool Supports(Insn::Handler handler) {
+      switch (handler) {
+      case Insn::INPUT:
+      case Insn::OUTPUT:
+        return Has(IntCodeOps::IO);
+      case Insn::JUMP_IF_TRUE:
+      case Insn::JUMP_IF_FALSE:
+      case Insn::LESS_THAN:
+      case Insn::EQUALS:
+      case Insn::LESS_THAN_JUMP:
+      case Insn::EQUALS_JUMP:
+      case Insn::ADD_JUMP:
+      case Insn::ADD_ADD_JUMP:
+        return Has(IntCodeOps::BRANCH);
+      case Insn::ADJUST_REL_PTR:
+      case Insn::ADJUST_ADD:
+        return Has(IntCodeOps::RELATIVE);
+      default:
+        return true;
+      }
+    }
+
+    [[nodiscard]] static constexpr bool Supports(ParamMode mode) {
+      return mode == ParamMode::POSITION ||
+             (mode == ParamMode::IMMEDIATE && Has(IntCodeOps::IMMEDIATE)) ||
+             (mode == ParamMode::RELATIVE && Has(IntCodeOps::RELATIVE));
+    }
+
+    [[nodiscard]] static bool Supports(const Insn& op) {
+      return Supports(op.GetHandler()) && Supports(op.ParamA()) &&
+             Supports(op.ParamB()) && Supports(op.ParamC());
+    }
+
+    [[noreturn, gnu::cold]] static void Unsupported(int64_t addr) {
+      throw std::runtime_error{"Unsupported Intcode instruction at " +
+                               std::to_string(addr)};
+    }
+
+    // An address held in a word, which must fit in an int64_t.
+    [[nodiscard]] static int64_t Narrow(Word val) {
+      if constexpr (sizeof(Word) > sizeof(int64_t)) {
+        if (val < INT64_MIN || val > INT64_MAX)
+          throw std::out_of_range{"Intcode address out of range"};
+      }
+      return static_cast<int64_t>(val);
+    }
+
+    [[nodiscard]] static Word Sum(Word a, Word b) {
+      if constexpr (Spec::CHECKED) {
+        Word ret;
+        if (__builtin_add_overflow(a, b, &ret))
+          throw std::overflow_error{"Intcode addition overflowed"};
+        return ret;
+      } else {
+        using Unsigned = std::make_unsigned_t<Word>;
+        return static_cast<Word>(static_cast<Unsigned>(a) +
+                                 static_cast<Unsigned>(b));
+      }
+    }
+
+    [[nodiscard]] static Word Product(Word a, Word b) {
+      if constexpr (Spec::CHECKED) {
+        Word ret;
+        if (__builtin_mul_overflow(a, b, &ret))
+          throw std::overflow_error{"Intcode multiplication overflowed"};
+        return ret;
+      } else {
+        using Unsigned = std::make_unsigned_t<Word>;
+        return static_cast<Word>(static_cast<Unsigned>(a) *
+                                 static_cast<Unsigned>(b));
+      }
+    }
+
+    // Decodes the instruction at addr, caching one this computer doesn't
+    // support as UNKNOWN so that dispatching it throws.
+    Insn Decode(int64_t addr) {
+      const auto op = mem.Decode(addr);
+      if constexpr (!FULL) {
+        if (!Supports(op)) {
+          mem.Install(addr, Insn{-1});
+          return Insn{-1};
+        }
+      }
+      return op;
+    }
+
+    // The cached decode at insnPtr, which is a default Insn if it has not been
+    // decoded yet. Also remembers the page holding the instruction so that
+    // its operands can be read without another lookup, unless the instruction
+    // might straddle the end of the page.
+    Insn Cached() {
+      const auto* page = mem.PageOf(insnPtr);
+      const auto off   = insnPtr++ & Memory::PAGE_MASK;
+      insnPage         = off < Memory::PAGE_WORDS - 3 ? page : nullptr;
+      return page->decoded[off];
+    }
+
+    Insn Fetch() {
+      const auto op = Cached();
+      return op.GetHandler() == Insn::DECODE ? Decode(insnPtr - 1) : op;
+    }
+
+    // Reports an instruction fetched by Cached() to the trace, decoding it
+    // first if needed.
+    Insn Traced(Insn op) {
+      if (op.GetHandler() == Insn::DECODE)
+        op = Decode(insnPtr - 1);
+      trace.OnInsn(insnPtr - 1, op, relPtr);
+      return op;
+    }
+
+    Word NextWord() {
+      const auto addr = insnPtr++;
+      return insnPage ? insnPage->words[addr & Memory::PAGE_MASK]
+                      : mem.Read(addr);
+    }
+
+    // Modes the spec leaves out never get past Decode(), so their cases are
+    // dropped here.
+    int64_t Addr(const ParamMode mode) {
+      if constexpr (!Has(IntCodeOps::RELATIVE)) {
+        if (Has(IntCodeOps::IMMEDIATE) && mode == ParamMode::IMMEDIATE)
+          return insnPtr++;
+        return Narrow(NextWord());
+      } else {
+        switch (mode) {
+        case ParamMode::POSITION:
+          return Narrow(NextWord());
+        case ParamMode::IMMEDIATE:
+          return insnPtr++;
+        case ParamMode::RELATIVE:
+          return Narrow(NextWord()) + relPtr;
+        }
+        return insnPtr++;
+      }
+    }
+
+    Word ReadData(int64_t addr) {
+      trace.OnRead(addr);
+      return mem.Read(addr);
+    }
+
+    Word GetArg(const ParamMode mode) {
+      if constexpr (!Has(IntCodeOps::IMMEDIATE))
+        return ReadData(Addr(mode));
+      else
+        return mode == ParamMode::IMMEDIATE ? NextWord()
+                                            : ReadData(Addr(mode));
+    }
+
+    void SetArg(const ParamMode mode, Word val) {
+      const auto addr = Addr(mode);
+      trace.OnWrite(addr);
+      mem.Write(addr, val);
+    }
+
+    std::pair<Word, Word> GetArgs(const Insn& op) {
+      auto a = GetArg(op.ParamA());
+      auto b = GetArg(op.ParamB());
+      return {a, b};
+    }
+
+    void Add(const Insn& op) {
+      auto [a, b] = GetArgs(op);
+      SetArg(op.ParamC(), Sum(a, b));
+    }
+
+    void Multiply(const Insn& op) {
+      auto [a, b] = GetArgs(op);
+      SetArg(op.ParamC(), Product(a, b));
+    }
+
+    void JumpIfTrue(const Insn& op) {
+      auto [a, b] = GetArgs(op);
+      if (a) {
+        const auto dest = Narrow(b);
+        trace.OnJump(insnPtr - 3, dest);
+        insnPtr = dest;
+      }
+    }
+
+    void JumpIfFalse(const Insn& op) {
+      auto [a, b] = GetArgs(op);
+      if (!a) {
+        const auto dest = Narrow(b);
+        trace.OnJump(insnPtr - 3, dest);
+        insnPtr = dest;
+      }
+    }
+
+    void LessThan(const Insn& op) {
+      auto [a, b] = GetArgs(op);
+      SetArg(op.ParamC(), a < b);
+    }
+
+    void Equals(const Insn& op) {
+      auto [a, b] = GetArgs(op);
+      SetArg(op.ParamC(), a == b);
+    }
+
+    void AdjustRelPtr(const Insn& op) {
+      relPtr += Narrow(GetArg(op.ParamA()));
+      trace.OnRelPtr(insnPtr - 2, relPtr);
+    }
+
+    void Store(Word input, const Insn& op) { SetArg(op.ParamA(), input); }
+
+    // Superinstructions run their first instruction from op and take the
+    // rest from the decode cache. Should one no longer be what the fusion
+    // was built for, because the program overwrote it, they stop before it
+    // and leave it to the dispatch loop.
+    bool Follow(Insn::Handler want, Insn& next) {
+      next               = Cached();
+      const auto handler = next.GetHandler();
+      if (handler == want || (IsJump(handler) && IsJump(want)))
+        return true;
+      --insnPtr;
+      return false;
+    }
+
+    // A conditional jump whose condition was just stored as val at addr, as
+    // it is after a compare, tests val rather than reading it back.
+    void JumpAfter(int64_t addr, Word val) {
+      Insn op;
+      if (!Follow(Insn::JUMP_IF_TRUE, op))
+        return;
+      Word cond = 0;
+      if (op.ParamA() == ParamMode::IMMEDIATE) {
+        cond = NextWord();
+      } else if (const auto condAddr = Addr(op.ParamA()); condAddr == addr) {
+        trace.OnRead(condAddr);
+        cond = val;
+      } else {
+        cond = ReadData(condAddr);
+      }
+      const auto dest = Narrow(GetArg(op.ParamB()));
+      if ((cond != 0) == (op.GetHandler() == Insn::JUMP_IF_TRUE)) {
+        trace.OnJump(insnPtr - 3, dest);
+        insnPtr = dest;
+      }
+    }
+
+    void Jump(const Insn& op) {
+      if (op.GetHandler() == Insn::JUMP_IF_TRUE)
+        JumpIfTrue(op);
+      else
+        JumpIfFalse(op);
+    }
+
+    template <bool LESS>
+    void CompareJump(const Insn& op) {
+      auto [a, b]     = GetArgs(op);
+      const Word val  = LESS ? a < b : a == b;
+      const auto addr = Addr(op.ParamC());
+      trace.OnWrite(addr);
+      mem.Write(addr, val);
+      JumpAfter(addr, val);
+    }
+
+    void AddJump(const Insn& op) {
+      Add(op);
+      if (Insn next; Follow(Insn::JUMP_IF_TRUE, next))
+        Jump(next);
+    }
+
+    void AdjustAdd(const Insn& op) {
+      AdjustRelPtr(op);
+      if (Insn next; Follow(Insn::ADD, next))
+        Add(next);
+    }
+
+    void AddAddJump(const Insn& op) {
+      Add(op);
+      if (Insn next; Follow(Insn::ADD, next)) {
+        Add(next);
+        if (Follow(Insn::JUMP_IF_TRUE, next))
+          Jump(next);
+      }
+    }
+
+    // The loader pass: decodes every instruction static analysis finds in
+    // the image, so that copies and forks of this computer start with a warm
+    // cache, then installs superinstructions over them. Fusions are only
+    // built from instructions the spec supports.
+    void Fuse(const std::vector<int64_t>& program) {
+      const IntCodeCfg cfg{program};
+      for (auto& block : cfg.Blocks()) {
+        for (auto pos = block.begin; pos < block.end; pos += cfg.Length(pos))
+          static_cast<void>(Decode(pos));
+      }
+      for (auto& fusion : FindFusions(cfg)) {
+        if (Supports(fusion.op))
+          mem.Install(fusion.addr, fusion.op);
+      }
+    }
+
+    Word Load(const Insn& op) { return GetArg(op.ParamA()); }
+
+    // A budgeted run returns nullopt once it has dispatched budget
+    // instructions, leaving insnPtr at the next one.
+    template <bool BUDGETED>
+    [[nodiscard]] std::optional<ExecState> ExecuteSwitch() {
+      while (true) {
+        if constexpr (BUDGETED) {
+          if (!budget)
+            return std::nullopt;
+          --budget;
+        }
+        const auto op = Fetch();
+        trace.OnInsn(insnPtr - 1, op, relPtr);
+        switch (op.GetHandler()) {
+        case Insn::ADD:
+          Add(op);
+          break;
+        case Insn::MULTIPLY:
+          Multiply(op);
+          break;
+        case Insn::INPUT:
+          if constexpr (Has(IntCodeOps::IO)) {
+            if (input.Empty()) {
+              --insnPtr;
+              return ExecState::NEED_INPUT;
+            }
+            Store(input.Pop(), op);
+          }
+          break;
+        case Insn::OUTPUT:
+          if constexpr (Has(IntCodeOps::IO)) {
+            output.Push(out = Load(op));
+            if (output.Size() >= outputsWanted)
+              return ExecState::HAS_OUTPUT;
+          }
+          break;
+        case Insn::JUMP_IF_TRUE:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            JumpIfTrue(op);
+          break;
+        case Insn::JUMP_IF_FALSE:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            JumpIfFalse(op);
+          break;
+        case Insn::LESS_THAN:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            LessThan(op);
+          break;
+        case Insn::EQUALS:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            Equals(op);
+          break;
+        case Insn::ADJUST_REL_PTR:
+          if constexpr (Has(IntCodeOps::RELATIVE))
+            AdjustRelPtr(op);
+          break;
+        case Insn::HALT:
+          --insnPtr;
+          return ExecState::HALTED;
+        case Insn::UNKNOWN:
+          if constexpr (!FULL)
+            Unsupported(insnPtr - 1);
+          break;
+        case Insn::LESS_THAN_JUMP:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            CompareJump<true>(op);
+          break;
+        case Insn::EQUALS_JUMP:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            CompareJump<false>(op);
+          break;
+        case Insn::ADD_JUMP:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            AddJump(op);
+          break;
+        case Insn::ADJUST_ADD:
+          if constexpr (Has(IntCodeOps::RELATIVE))
+            AdjustAdd(op);
+          break;
+        case Insn::ADD_ADD_JUMP:
+          if constexpr (Has(IntCodeOps::BRANCH))
+            AddAddJump(op);
+          break;
+        case Insn::DECODE:
+          // Fetch() always decodes first.
+          throw std::logic_error{"Undecoded Intcode instruction"};
+        }
+      }
+    }
+
+#ifdef AOC_INTCODE_THREADED_DISPATCH
+    // Runs the same handlers as ExecuteSwitch, so results are identical.
+    template <bool BUDGETED>
+    [[nodiscard]] std::optional<ExecState> ExecuteThreaded() {
+      // Handlers the spec leaves out are never reached, so they all share
+      // one label and their bodies compile to nothing.
+      constexpr bool IO       = Has(IntCodeOps::IO);
+      constexpr bool BRANCH   = Has(IntCodeOps::BRANCH);
+      constexpr bool RELATIVE = Has(IntCodeOps::RELATIVE);
+      static const void* const handlers[] = {
+        &&decode,
+        &&add,
+        &&multiply,
+        IO ? &&input : &&unsupported,
+        IO ? &&output : &&unsupported,
+        BRANCH ? &&jumpIfTrue : &&unsupported,
+        BRANCH ? &&jumpIfFalse : &&unsupported,
+        BRANCH ? &&lessThan : &&unsupported,
+        BRANCH ? &&equals : &&unsupported,
+        RELATIVE ? &&adjustRelPtr : &&unsupported,
+        &&halt,
+        FULL ? &&unknown : &&unsupported,
+        BRANCH ? &&lessThanJump : &&unsupported,
+        BRANCH ? &&equalsJump : &&unsupported,
+        BRANCH ? &&addJump : &&unsupported,
+        RELATIVE ? &&adjustAdd : &&unsupported,
+        BRANCH ? &&addAddJump : &&unsupported,
+      };
+      Insn op;
+#  define AOC_INTCODE_DISPATCH()  \
+    if constexpr (BUDGETED) {     \
+      if (!budget)                \
+        return std::nullopt;      \
+      --budget;                   \
+    }                             \
+    op = Cached();                \
+    if constexpr (Trace::ENABLED) \
+      op = Traced(op);            \
+    goto* handlers[op.GetHandler()]
+
+      AOC_INTCODE_DISPATCH();
+    decode:
+      op = Decode(insnPtr - 1);
+      goto* handlers[op.GetHandler()];
+    add:
+      Add(op);
+      AOC_INTCODE_DISPATCH();
+    multiply:
+      Multiply(op);
+      AOC_INTCODE_DISPATCH();
+    input:
+      if constexpr (IO) {
+        if (input.Empty()) {
+          --insnPtr;
+          return ExecState::NEED_INPUT;
+        }
+        Store(input.Pop(), op);
+      }
+      AOC_INTCODE_DISPATCH();
+    output:
+      if constexpr (IO) {
+        output.Push(out = Load(op));
+        if (output.Size() >= outputsWanted)
+          return ExecState::HAS_OUTPUT;
+      }
+      AOC_INTCODE_DISPATCH();
+    jumpIfTrue:
+      if constexpr (BRANCH)
+        JumpIfTrue(op);
+      AOC_INTCODE_DISPATCH();
+    jumpIfFalse:
+      if constexpr (BRANCH)
+        JumpIfFalse(op);
+      AOC_INTCODE_DISPATCH();
+    lessThan:
+      if constexpr (BRANCH)
+        LessThan(op);
+      AOC_INTCODE_DISPATCH();
+    equals:
+      if constexpr (BRANCH)
+        Equals(op);
+      AOC_INTCODE_DISPATCH();
+    adjustRelPtr:
+      if constexpr (RELATIVE)
+        AdjustRelPtr(op);
+      AOC_INTCODE_DISPATCH();
+    halt:
+      --insnPtr;
+      return ExecState::HALTED;
+    unknown:
+      AOC_INTCODE_DISPATCH();
+    unsupported:
+      Unsupported(insnPtr - 1);
+    lessThanJump:
+      if constexpr (BRANCH)
+        CompareJump<true>(op);
+      AOC_INTCODE_DISPATCH();
+    equalsJump:
+      if constexpr (BRANCH)
+        CompareJump<false>(op);
+      AOC_INTCODE_DISPATCH();
+    addJump:
+      if constexpr (BRANCH)
+        AddJump(op);
+      AOC_INTCODE_DISPATCH();
+    adjustAdd:
+      if constexpr (RELATIVE)
+        AdjustAdd(op);
+      AOC_INTCODE_DISPATCH();
+    addAddJump:
+      if constexpr (BRANCH)
+        AddAddJump(op);
+      AOC_INTCODE_DISPATCH();
+#  undef AOC_INTCODE_DISPATCH
+    }
+#endif
+
+    explicit BasicIntCodeComputer(Memory&& mem) : mem{std::move(mem)} {}
+
+   public:
+    // Throws if a word of program doesn't fit in Word.
+    BasicIntCodeComputer(const std::vector<int64_t>& program,
+                         Fusion fusion = Fusion::OFF)
+        : mem{program} {
+      if (fusion == Fusion::ON)
+        Fuse(program);
+    }
+
+    // A snapshot of this computer which shares its memory copy-on-write, so
+    // spawning many variants of one program only copies the pages they
+    // write. The fork starts with a fresh trace.
+    [[nodiscard]] BasicIntCodeComputer Fork() {
+      BasicIntCodeComputer ret{mem.Fork()};
+      ret.input   = input;
+      ret.output  = output;
+      ret.insnPtr = insnPtr;
+      ret.relPtr  = relPtr;
+      ret.out     = out;
+      return ret;
+    }
+
+    [[nodiscard]] Word Peek(int64_t addr) const { return mem.Read(addr); }
+
+    BasicIntCodeComputer& Poke(int64_t addr, Word val) {
+      mem.Write(addr, val);
+      return *this;
+    }
+
+    // The most recent output, whether or not it has been popped.
+    [[nodiscard]] Word Out() const noexcept { return out; }
+
+    [[nodiscard]] size_t OutputCount() const noexcept { return output.Size(); }
+
+    Word PopOutput() { return output.Pop(); }
+
+    BasicIntCodeComputer& PushInput(Word val) {
+      input.Push(val);
+      return *this;
+    }
+
+    // Runs until the output channel holds outputsWanted values, the program
+    // needs input that hasn't been pushed, or it halts. Zero means no output
+    // limit. Outputs stay queued until popped, so a stream of them costs one
+    // call rather than one per value.
+    template <Dispatch D = Dispatch::SWITCH>
+    [[nodiscard]] ExecState RunUntil(size_t outputsWanted) {
+      this->outputsWanted = outputsWanted ? outputsWanted : SIZE_MAX;
+      if (output.Size() >= this->outputsWanted)
+        return ExecState::HAS_OUTPUT;
+#ifdef AOC_INTCODE_THREADED_DISPATCH
+      if constexpr (D == Dispatch::THREADED)
+        return *ExecuteThreaded<false>();
+#endif
+      return *ExecuteSwitch<false>();
+    }
+
+    // Like RunUntil(), but also gives up after dispatching budget
+    // instructions and returns nullopt, so that a scheduler can time-slice
+    // machines. A superinstruction counts as one. budget is reduced by the
+    // number dispatched, so what is left of a slice carries across outputs.
+    template <Dispatch D = Dispatch::SWITCH>
+    [[nodiscard]] std::optional<ExecState> RunFor(uint64_t& budget,
+                                                  size_t outputsWanted) {
+      this->outputsWanted = outputsWanted ? outputsWanted : SIZE_MAX;
+      if (output.Size() >= this->outputsWanted)
+        return ExecState::HAS_OUTPUT;
+      this->budget = budget;
+      std::optional<ExecState> ret;
+#ifdef AOC_INTCODE_THREADED_DISPATCH
+      if constexpr (D == Dispatch::THREADED)
+        ret = ExecuteThreaded<true>();
+      else
+#endif
+        ret = ExecuteSwitch<true>();
+      budget = this->budget;
+      return ret;
+    }
+
+    // Runs until the next output, which Out() then returns. Any outputs left
+    // queued by RunUntil() are discarded.
+    template <Dispatch D = Dispatch::SWITCH>
+    [[nodiscard]] ExecState Execute() {
+      output.Clear();
+      return RunUntil<D>(1);
+    }
+
+    [[nodiscard]] Trace& GetTrace() noexcept { return trace; }
+    [[nodiscard]] const Trace& GetTrace() const noexcept { return trace; }
+  };
+
+  using IntCodeComputer = BasicIntCodeComputer<>;
+
+  // An untraced computer specialized for Spec.
+  template <class Spec>
+  using IntCodeMachine = BasicIntCodeComputer<IntCodeNoTrace, Spec>;
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODE
@@ -0,0 +1,284 @@
+#ifndef AOC_UTIL_INTCODEANALYSIS
+#define AOC_UTIL_INTCODEANALYSIS
+
+#include "util/IntCodeInsn.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace AoC {
+  // Words taken by an instruction with this handler, including the opcode.
+  [[nodiscard]] constexpr int64_t InsnLength(Insn::Handler handler) noexcept {
+    switch (handler) {
+    case Insn::ADD:
+    case Insn::MULTIPLY:
+    case Insn::LESS_THAN:
+    case Insn::EQUALS:
+      return 4;
+    case Insn::JUMP_IF_TRUE:
+    case Insn::JUMP_IF_FALSE:
+      return 3;
+    case Insn::INPUT:
+    case Insn::OUTPUT:
+    case Insn::ADJUST_REL_PTR:
+      return 2;
+    default:
+      return 1;
+    }
+  }
+
+  // A short name for each handler, as used in reports.
+  [[nodiscard]] constexpr const char* HandlerName(Insn::Handler handler) {
+    constexpr const char* names[] = {"decode",
+                                     "add",
+                                     "multiply",
+                                     "input",
+                                     "output",
+                                     "jump-true",
+                                     "jump-false",
+                                     "less-than",
+                                     "equals",
+                                     "rel-base",
+                                     "halt",
+                                     "unknown",
+                                     "lt+jump",
+                                     "eq+jump",
+                                     "add+jump",
+                                     "rel+add",
+                                     "add+add+jump"};
+    static_assert(std::size(names) == Insn::HANDLERS);
+    return names[handler];
+  }
+
+  // The instruction in word, or nullopt if it isn't a valid one.
+  [[nodiscard]] inline std::optional<Insn> TryDecode(int64_t word) {
+    try {
+      const Insn op{word};
+      if (op.GetHandler() == Insn::UNKNOWN)
+        return std::nullopt;
+      return op;
+    } catch (const std::runtime_error&) {
+      return std::nullopt;
+    }
+  }
+
+  [[nodiscard]] constexpr bool IsJump(Insn::Handler handler) noexcept {
+    return handler == Insn::JUMP_IF_TRUE || handler == Insn::JUMP_IF_FALSE;
+  }
+
+  // A static disassembly of a program image into basic blocks. Code is found
+  // by following execution from address 0 through fall-throughs and
+  // immediate jump targets. Jumps through memory can't be followed, so values
+  // stored by an immediate add or multiply by the identity, which is how
+  // return addresses are pushed, are tried as entry points too. Those never
+  // displace code that was already found.
+  class IntCodeCfg {
+   public:
+    struct Block {
+      int64_t begin;
+      int64_t end;
+      // Known successors. A jump through memory has none that are known.
+      std::vector<int64_t> next;
+    };
+
+   private:
+    const std::vector<int64_t>& image;
+    // Per word: length of the instruction starting there, and whether it is
+    // part of one.
+    std::vector<uint8_t> lengths;
+    std::vector<uint8_t> code;
+    std::vector<uint8_t> leaders;
+    std::vector<int64_t> candidates;
+    std::vector<Block> blocks;
+
+    [[nodiscard]] int64_t Size() const {
+      return static_cast<int64_t>(image.size());
+    }
+
+    [[nodiscard]] bool InImage(int64_t pos) const {
+      return pos >= 0 && pos < Size();
+    }
+
+    // Disassembles straight-line code from pos until it halts, jumps away for
+    // good, or runs into something that isn't a fresh instruction.
+    void Walk(int64_t pos, std::vector<int64_t>& work) {
+      if (InImage(pos) && !code[pos])
+        leaders[pos] = 1;
+      while (InImage(pos) && !code[pos]) {
+        const auto op = TryDecode(image[pos]);
+        if (!op)
+          return;
+        const auto handler = op->GetHandler();
+        const auto len     = InsnLength(handler);
+        if (pos + len > Size() ||
+            std::any_of(code.begin() + pos,
+                        code.begin() + pos + len,
+                        [](auto word) { return word; }))
+          return;
+        lengths[pos] = static_cast<uint8_t>(len);
+        std::fill(code.begin() + pos, code.begin() + pos + len, 1);
+
+        if (handler == Insn::HALT)
+          return;
+        if (IsJump(handler)) {
+          if (op->ParamB() == ParamMode::IMMEDIATE)
+            work.emplace_back(image[pos + 2]);
+          if (InImage(pos + len))
+            leaders[pos + len] = 1;
+          if (op->ParamA() == ParamMode::IMMEDIATE &&
+              (image[pos + 1] != 0) == (handler == Insn::JUMP_IF_TRUE))
+            return;
+        }
+        if ((handler == Insn::ADD || handler == Insn::MULTIPLY) &&
+            op->ParamA() == ParamMode::IMMEDIATE &&
+            op->ParamB() == ParamMode::IMMEDIATE) {
+          const auto identity = handler == Insn::ADD ? 0 : 1;
+          if (image[pos + 2] == identity)
+            candidates.emplace_back(image[pos + 1]);
+          else if (image[pos + 1] == identity)
+            candidates.emplace_back(image[pos + 2]);
+        }
+        pos += len;
+      }
+    }
+
+    void Discover() {
+      std::vector<int64_t> work{0};
+      auto drain = [&] {
+        while (!work.empty()) {
+          const auto pos = work.back();
+          work.pop_back();
+          if (InImage(pos) && lengths[pos])
+            leaders[pos] = 1;
+          Walk(pos, work);
+        }
+      };
+      drain();
+      while (!candidates.empty()) {
+        work.swap(candidates);
+        drain();
+      }
+    }
+
+    void Split() {
+      for (int64_t pos = 0; pos < Size();) {
+        if (!lengths[pos]) {
+          ++pos;
+          continue;
+        }
+        Block block{pos, pos, {}};
+        bool fallsThrough = true;
+        do {
+          const Insn op{image[block.end]};
+          const auto handler = op.GetHandler();
+          if (IsJump(handler)) {
+            if (op.ParamB() == ParamMode::IMMEDIATE)
+              block.next.emplace_back(image[block.end + 2]);
+            fallsThrough =
+              op.ParamA() != ParamMode::IMMEDIATE ||
+              (image[block.end + 1] != 0) != (handler == Insn::JUMP_IF_TRUE);
+          } else if (handler == Insn::HALT) {
+            fallsThrough = false;
+          }
+          block.end += lengths[block.end];
+        } while (fallsThrough && InImage(block.end) && lengths[block.end] &&
+                 !leaders[block.end]);
+        if (fallsThrough)
+          block.next.emplace_back(block.end);
+        pos = block.end;
+        blocks.emplace_back(std::move(block));
+      }
+    }
+
+   public:
+    explicit IntCodeCfg(const std::vector<int64_t>& image)
+        : image{image}, lengths(image.size()), code(image.size()),
+          leaders(image.size()) {
+      Discover();
+      Split();
+    }
+
+    [[nodiscard]] const std::vector<int64_t>& Image() const noexcept {
+      return image;
+    }
+
+    // Length of the instruction found at pos, or 0 if none was.
+    [[nodiscard]] int64_t Length(int64_t pos) const {
+      return InImage(pos) ? lengths[pos] : 0;
+    }
+
+    // Whether pos is part of any instruction found.
+    [[nodiscard]] bool IsCode(int64_t pos) const {
+      return InImage(pos) && code[pos];
+    }
+
+    [[nodiscard]] const std::vector<Block>& Blocks() const noexcept {
+      return blocks;
+    }
+  };
+
+  // A superinstruction to install at addr, covering length words.
+  struct IntCodeFusion {
+    int64_t addr;
+    int64_t length;
+    Insn op;
+  };
+
+  // Finds runs of instructions inside one basic block that IntCodeComputer
+  // has a superinstruction for. Runs never overlap, and the longest pattern
+  // at an address wins.
+  [[nodiscard]] inline std::vector<IntCodeFusion> FindFusions(
+    const IntCodeCfg& cfg) {
+    struct Pattern {
+      Insn::Handler fused;
+      std::array<Insn::Handler, 3> parts;
+      size_t count;
+    };
+    // Longest first. A jump part matches either kind of conditional jump.
+    static constexpr Pattern patterns[] = {
+      {Insn::ADD_ADD_JUMP,
+       {Insn::ADD, Insn::ADD, Insn::JUMP_IF_TRUE},
+       3},
+      {Insn::LESS_THAN_JUMP, {Insn::LESS_THAN, Insn::JUMP_IF_TRUE}, 2},
+      {Insn::EQUALS_JUMP, {Insn::EQUALS, Insn::JUMP_IF_TRUE}, 2},
+      {Insn::ADD_JUMP, {Insn::ADD, Insn::JUMP_IF_TRUE}, 2},
+      {Insn::ADJUST_ADD, {Insn::ADJUST_REL_PTR, Insn::ADD}, 2},
+    };
+    const auto& image = cfg.Image();
+    auto matches      = [&](int64_t pos, int64_t end, const Pattern& pattern) {
+      for (size_t i = 0; i < pattern.count; ++i) {
+        if (pos >= end)
+          return int64_t{0};
+        const auto handler = Insn{image[pos]}.GetHandler();
+        const auto want    = pattern.parts[i];
+        if (handler != want && !(IsJump(handler) && IsJump(want)))
+          return int64_t{0};
+        pos += cfg.Length(pos);
+      }
+      return pos;
+    };
+    std::vector<IntCodeFusion> ret;
+    for (auto& block : cfg.Blocks()) {
+      for (auto pos = block.begin; pos < block.end;) {
+        int64_t next = 0;
+        for (auto& pattern : patterns) {
+          if ((next = matches(pos, block.end, pattern))) {
+            ret.push_back({pos, next - pos, Insn{image[pos]}.WithHandler(
+                                              pattern.fused)});
+            break;
+          }
+        }
+        pos = next ? next : pos + cfg.Length(pos);
+      }
+    }
+    return ret;
+  }
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEANALYSIS
@@ -0,0 +1,145 @@
+#ifndef AOC_UTIL_INTCODEAOT
+#define AOC_UTIL_INTCODEAOT
+
+#include "util/IntCode.h"
+#include "util/IntCodeFlat.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace AoC {
+  class IntCodeAotContext;
+
+  // An Intcode image translated to C++ ahead of time by tools/intcode_aot.
+  // lengths holds, for each image word, the length of the compiled
+  // instruction that starts there, or 0 if run can't be entered there. run
+  // executes from the context's instruction pointer and returns a state when
+  // execution stops, or nullopt to have the instruction it stopped at
+  // interpreted.
+  struct IntCodeAotProgram {
+    const int64_t* image;
+    size_t imageSize;
+    const uint8_t* lengths;
+    std::optional<ExecState> (*run)(IntCodeAotContext&);
+  };
+
+  // Runs an ahead-of-time compiled Intcode program with the same interface
+  // and results as IntCodeComputer. Compiled code only covers the image it
+  // was generated from: if the image given here differs, or an instruction
+  // is overwritten at run time, those parts are interpreted instead.
+  class IntCodeAot : public IntCodeFlatMachine {
+    friend class IntCodeAotContext;
+
+    const IntCodeAotProgram* program;
+    // Per image word: the compiled instruction starting here was overwritten.
+    std::vector<uint8_t> stale;
+
+    void CodeWritten(int64_t addr) override {
+      for (auto pos = std::max<int64_t>(addr - 3, 0); pos <= addr; ++pos) {
+        if (program->lengths[pos] > addr - pos)
+          stale[pos] = 1;
+      }
+    }
+
+    [[nodiscard]] bool Compiled(int64_t pos) const noexcept {
+      return pos >= 0 && pos < static_cast<int64_t>(program->imageSize) &&
+             program->lengths[pos] && !stale[pos];
+    }
+
+    ExecState Run() override;
+
+   public:
+    IntCodeAot(const IntCodeAotProgram& program,
+               const std::vector<int64_t>& image)
+        : IntCodeFlatMachine{image}, program{&program},
+          stale(program.imageSize, 1) {
+      if (!std::equal(image.begin(),
+                      image.end(),
+                      program.image,
+                      program.image + program.imageSize))
+        return;
+      std::fill(stale.begin(), stale.end(), 0);
+      for (size_t pos = 0; pos < program.imageSize; ++pos) {
+        const auto end = std::min(pos + program.lengths[pos], code.size());
+        std::fill(code.begin() + pos, code.begin() + end, 1);
+      }
+    }
+
+    explicit IntCodeAot(const IntCodeAotProgram& program)
+        : IntCodeAot{program,
+                     {program.image, program.image + program.imageSize}} {}
+
+    // Whether any of this machine's image is running as compiled code.
+    [[nodiscard]] bool Native() const noexcept {
+      return std::find(stale.begin(), stale.end(), 0) != stale.end();
+    }
+  };
+
+  // The view of an IntCodeAot that generated code works through. Addresses
+  // passed to Word must lie inside the compiled image.
+  class IntCodeAotContext {
+    IntCodeAot& vm;
+
+   public:
+    explicit IntCodeAotContext(IntCodeAot& vm) : vm{vm} {}
+
+    [[nodiscard]] int64_t& InsnPtr() noexcept { return vm.insnPtr; }
+    [[nodiscard]] int64_t& RelPtr() noexcept { return vm.relPtr; }
+
+    [[nodiscard]] bool Stale(int64_t pos) const noexcept {
+      return vm.stale[pos];
+    }
+
+    [[nodiscard]] int64_t& Word(int64_t addr) noexcept {
+      return vm.mem[addr];
+    }
+
+    [[nodiscard]] int64_t Load(int64_t addr) const {
+      if (static_cast<uint64_t>(addr) < vm.mem.size())
+        return vm.mem[addr];
+      return vm.Read(addr);
+    }
+
+    // Returns whether the store overwrote compiled code, in which case the
+    // caller must leave compiled code before running anything else.
+    bool Store(int64_t addr, int64_t val) {
+      if (static_cast<uint64_t>(addr) < vm.mem.size() && !vm.code[addr]) {
+        vm.mem[addr] = val;
+        return false;
+      }
+      const bool hit =
+        static_cast<uint64_t>(addr) < vm.code.size() && vm.code[addr];
+      vm.Write(addr, val);
+      return hit;
+    }
+
+    [[nodiscard]] bool InputEmpty() const noexcept { return vm.input.Empty(); }
+
+    int64_t PopInput() { return vm.input.Pop(); }
+
+    // Returns whether enough output has been produced to stop.
+    bool Output(int64_t val) {
+      vm.output.Push(vm.out = val);
+      return vm.output.Size() >= vm.outputsWanted;
+    }
+  };
+
+  inline ExecState IntCodeAot::Run() {
+    IntCodeAotContext ctx{*this};
+    while (true) {
+      if (Compiled(insnPtr)) {
+        if (auto state = program->run(ctx))
+          return *state;
+        if (Compiled(insnPtr))
+          continue;
+      }
+      if (auto state = Step())
+        return *state;
+    }
+  }
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEAOT
@@ -0,0 +1,189 @@
+#ifndef AOC_UTIL_INTCODEASM
+#define AOC_UTIL_INTCODEASM
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A small assembler for writing Intcode by hand. Each line holds at most one
+// statement, and anything after a ';' is a comment:
+//
+//   name:           a label for the address of the next word
+//   add a b c       an instruction: add, mul, in, out, jt, jf, lt, eq, arb
+//                   or halt, followed by its operands
+//   data v...       literal words
+//
+// An operand is in position mode by default, #x for immediate mode and @x
+// for relative mode. x is a number, a label, or a label plus or minus a
+// number, as in loop+1 for the first operand of the instruction at loop,
+// which is how self-modifying code patches an address. Labels may be used
+// before they are defined, and may share a line with a statement.
+namespace AoC {
+  class IntCodeAssembler {
+    struct Mnemonic {
+      std::string_view name;
+      int64_t opcode;
+      size_t operands;
+    };
+    static constexpr Mnemonic MNEMONICS[] = {
+      {"add", 1, 3}, {"mul", 2, 3}, {"in", 3, 1},  {"out", 4, 1},
+      {"jt", 5, 2},  {"jf", 6, 2},  {"lt", 7, 3},  {"eq", 8, 3},
+      {"arb", 9, 1}, {"halt", 99, 0},
+    };
+
+    // A word whose value may depend on a label, filled in once every label
+    // is known.
+    struct Word {
+      size_t line;
+      std::string_view label;
+      int64_t offset;
+    };
+
+    std::unordered_map<std::string_view, int64_t> labels;
+    std::vector<Word> words;
+    size_t line = 0;
+
+    [[noreturn]] void Fail(const std::string& what) const {
+      throw std::runtime_error{"Intcode assembly line " +
+                               std::to_string(line) + ": " + what};
+    }
+
+    static std::string_view Trim(std::string_view text) {
+      const auto begin = text.find_first_not_of(" \t\r");
+      if (begin == std::string_view::npos)
+        return {};
+      return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+    }
+
+    // Splits off the next whitespace separated token of text.
+    static std::string_view Next(std::string_view& text) {
+      text             = Trim(text);
+      const auto end   = text.find_first_of(" \t");
+      const auto token = text.substr(0, end);
+      text.remove_prefix(token.size());
+      return token;
+    }
+
+    // Nothing if text doesn't look like a number, which makes it a label.
+    [[nodiscard]] std::optional<int64_t> Number(std::string_view text) const {
+      if (text.empty() ||
+          (text[0] != '-' && (text[0] < '0' || text[0] > '9')))
+        return std::nullopt;
+      const auto* end = text.data() + text.size();
+      int64_t ret     = 0;
+      auto [ptr, ec]  = std::from_chars(text.data(), end, ret);
+      if (ec != std::errc{} || ptr != end)
+        Fail("bad number " + std::string{text});
+      return ret;
+    }
+
+    // A number, label, or label+n / label-n.
+    [[nodiscard]] Word Value(std::string_view text) const {
+      if (auto val = Number(text))
+        return {line, {}, *val};
+      const auto sign = text.find_first_of("+-");
+      Word ret{line, text.substr(0, sign), 0};
+      if (sign != std::string_view::npos) {
+        const auto offset = Number(text.substr(sign + 1));
+        if (!offset)
+          Fail("bad offset in " + std::string{text});
+        ret.offset = text[sign] == '-' ? -*offset : *offset;
+      }
+      if (ret.label.empty())
+        Fail("missing operand");
+      return ret;
+    }
+
+    void Instruction(const Mnemonic& mnemonic, std::string_view rest) {
+      const auto at = words.size();
+      words.push_back({line, {}, mnemonic.opcode});
+      int64_t scale = 100;
+      for (size_t i = 0; i < mnemonic.operands; ++i, scale *= 10) {
+        auto operand = Next(rest);
+        if (operand.empty())
+          Fail(std::string{mnemonic.name} + " takes " +
+               std::to_string(mnemonic.operands) + " operands");
+        int64_t mode = 0;
+        if (operand[0] == '#' || operand[0] == '@') {
+          mode = operand[0] == '#' ? 1 : 2;
+          operand.remove_prefix(1);
+        }
+        words[at].offset += mode * scale;
+        words.emplace_back(Value(operand));
+      }
+      if (!Trim(rest).empty())
+        Fail("too many operands");
+    }
+
+    void Statement(std::string_view text) {
+      auto rest       = text;
+      const auto name = Next(rest);
+      if (name == "data") {
+        for (auto val = Next(rest); !val.empty(); val = Next(rest))
+          words.emplace_back(Value(val));
+        return;
+      }
+      for (auto& mnemonic : MNEMONICS) {
+        if (mnemonic.name == name)
+          return Instruction(mnemonic, rest);
+      }
+      Fail("unknown instruction " + std::string{name});
+    }
+
+   public:
+    // Throws on a syntax error, naming the line. Labels refer into source,
+    // which must outlive the assembler.
+    explicit IntCodeAssembler(std::string_view source) {
+      while (!source.empty()) {
+        ++line;
+        const auto eol = source.find('\n');
+        auto text      = source.substr(0, eol);
+        source.remove_prefix(eol == std::string_view::npos ? source.size()
+                                                            : eol + 1);
+        text = Trim(text.substr(0, text.find(';')));
+        if (const auto colon = text.find(':'); colon != text.npos) {
+          const auto label = Trim(text.substr(0, colon));
+          if (label.empty() || Number(label))
+            Fail("bad label");
+          if (!labels.emplace(label, words.size()).second)
+            Fail("duplicate label " + std::string{label});
+          text = Trim(text.substr(colon + 1));
+        }
+        if (!text.empty())
+          Statement(text);
+      }
+    }
+
+    [[nodiscard]] std::vector<int64_t> Image() const {
+      std::vector<int64_t> ret;
+      ret.reserve(words.size());
+      for (auto& word : words) {
+        if (word.label.empty()) {
+          ret.emplace_back(word.offset);
+          continue;
+        }
+        const auto iter = labels.find(word.label);
+        if (iter == labels.end())
+          throw std::runtime_error{"Intcode assembly line " +
+                                   std::to_string(word.line) +
+                                   ": undefined label " +
+                                   std::string{word.label}};
+        ret.emplace_back(iter->second + word.offset);
+      }
+      return ret;
+    }
+  };
+
+  [[nodiscard]] inline std::vector<int64_t> IntCodeAssemble(
+    std::string_view source) {
+    return IntCodeAssembler{source}.Image();
+  }
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEASM
@@ -0,0 +1,405 @@
+#ifndef AOC_UTIL_INTCODEBATCH
+#define AOC_UTIL_INTCODEBATCH
+
+#include "util/IntCode.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AoC {
+  // Runs many copies of one program in lockstep. Memory is stored
+  // structure-of-arrays, one row of lanes per address, so an instruction whose
+  // operands sit at the same address in every lane becomes a loop over
+  // contiguous rows which the compiler vectorises. Lanes sharing an
+  // instruction pointer form a group; a group only splits where its lanes'
+  // jump targets or opcodes differ, and groups merge again when they reach
+  // the same instruction. Each lane behaves exactly like its own
+  // IntCodeComputer.
+  class IntCodeBatch {
+    struct Group {
+      int64_t insnPtr;
+      std::vector<uint32_t> lanes;
+    };
+
+    size_t lanes;
+    // Addresses below nearRows are stored in one block, further ones get a
+    // row each so a stray far write doesn't allocate every address before it.
+    int64_t nearRows = 0;
+    std::vector<int64_t> near;
+    std::unordered_map<int64_t, std::vector<int64_t>> far;
+    std::vector<int64_t> zeroes;
+    std::vector<std::queue<int64_t>> input;
+    std::vector<int64_t> insnPtr;
+    std::vector<int64_t> relPtr;
+    std::vector<int64_t> out;
+    std::vector<ExecState> state;
+    std::vector<Group> pending;
+
+    [[nodiscard]] const int64_t* Row(int64_t addr) const {
+      if (addr < 0)
+        throw std::out_of_range{"Negative Intcode address"};
+      if (addr < nearRows)
+        return &near[addr * lanes];
+      auto iter = far.find(addr);
+      return iter == far.end() ? zeroes.data() : iter->second.data();
+    }
+
+    // May move the near block, so fetch it before any Row() it is used with.
+    [[nodiscard]] int64_t* MutableRow(int64_t addr) {
+      if (addr < 0)
+        throw std::out_of_range{"Negative Intcode address"};
+      if (addr < nearRows)
+        return &near[addr * lanes];
+      if (addr < nearRows * 2 + 1024) {
+        const auto rows = std::max(addr + 1, nearRows * 2);
+        near.resize(rows * lanes);
+        for (auto iter = far.begin(); iter != far.end();) {
+          if (iter->first >= rows) {
+            ++iter;
+            continue;
+          }
+          std::copy(iter->second.begin(),
+                    iter->second.end(),
+                    near.begin() + iter->first * lanes);
+          iter = far.erase(iter);
+        }
+        nearRows = rows;
+        return &near[addr * lanes];
+      }
+      auto& row = far[addr];
+      row.resize(lanes);
+      return row.data();
+    }
+
+    [[nodiscard]] int64_t Read(uint32_t lane, int64_t addr) const {
+      return Row(addr)[lane];
+    }
+
+    int64_t Addr(uint32_t lane, int64_t pos, ParamMode mode) const {
+      switch (mode) {
+      case ParamMode::POSITION:
+        return Read(lane, pos);
+      case ParamMode::IMMEDIATE:
+        return pos;
+      case ParamMode::RELATIVE:
+        return Read(lane, pos) + relPtr[lane];
+      }
+      return pos;
+    }
+
+    int64_t Arg(uint32_t lane, int64_t pos, ParamMode mode) const {
+      return Read(lane, Addr(lane, pos, mode));
+    }
+
+    [[nodiscard]] static bool Uniform(const int64_t* row, const Group& group) {
+      const auto val = row[group.lanes.front()];
+      return std::all_of(group.lanes.begin(),
+                         group.lanes.end(),
+                         [&](uint32_t lane) { return row[lane] == val; });
+    }
+
+    // The address a parameter refers to if it is the same in every lane of
+    // the group.
+    [[nodiscard]] std::optional<int64_t> UniformAddr(const Group& group,
+                                                     int64_t pos,
+                                                     ParamMode mode) const {
+      if (mode == ParamMode::IMMEDIATE)
+        return pos;
+      const auto* row = Row(pos);
+      if (!Uniform(row, group))
+        return std::nullopt;
+      if (mode == ParamMode::POSITION)
+        return row[group.lanes.front()];
+      if (!Uniform(relPtr.data(), group))
+        return std::nullopt;
+      return row[group.lanes.front()] + relPtr[group.lanes.front()];
+    }
+
+    // Applies func to every lane of the group, as one pass over contiguous
+    // lanes if the group holds all of them. That pass vectorises: the count
+    // is a local because a store through an int64_t row could alias
+    // this->lanes, and rows are either the same row or disjoint.
+    template <class Func>
+    void ForEachLane(const Group& group, Func func) const {
+      if (group.lanes.size() == lanes) {
+        const auto count = static_cast<uint32_t>(lanes);
+        for (uint32_t lane = 0; lane < count; ++lane)
+          func(lane);
+      } else {
+        for (auto lane : group.lanes)
+          func(lane);
+      }
+    }
+
+    // Add, multiply, less than and equals. When the parameters are at the
+    // same addresses in every lane this is a single pass over three rows.
+    template <class Op>
+    void Arithmetic(const Group& group, const Insn& op, Op func) {
+      const auto pos = group.insnPtr;
+      const auto c   = UniformAddr(group, pos + 3, op.ParamC());
+      const auto a   = UniformAddr(group, pos + 1, op.ParamA());
+      const auto b   = UniformAddr(group, pos + 2, op.ParamB());
+      if (a && b && c) {
+        auto* dst       = MutableRow(*c);
+        const auto* lhs = Row(*a);
+        const auto* rhs = Row(*b);
+        ForEachLane(group, [&](uint32_t lane) {
+          dst[lane] = func(lhs[lane], rhs[lane]);
+        });
+        return;
+      }
+      for (auto lane : group.lanes) {
+        const auto lhs = Arg(lane, pos + 1, op.ParamA());
+        const auto rhs = Arg(lane, pos + 2, op.ParamB());
+        MutableRow(Addr(lane, pos + 3, op.ParamC()))[lane] = func(lhs, rhs);
+      }
+    }
+
+    // The jump target for every lane of the group, or a single target if the
+    // lanes agree.
+    std::optional<int64_t> Jump(const Group& group,
+                                const Insn& op,
+                                std::vector<int64_t>& next) const {
+      const auto pos    = group.insnPtr;
+      const bool onTrue = op.GetHandler() == Insn::JUMP_IF_TRUE;
+      const auto a      = UniformAddr(group, pos + 1, op.ParamA());
+      const auto b      = UniformAddr(group, pos + 2, op.ParamB());
+      if (a && b) {
+        const auto* cond   = Row(*a);
+        const auto* target = Row(*b);
+        const auto first   = group.lanes.front();
+        if (Uniform(cond, group) &&
+            ((cond[first] != 0) != onTrue || Uniform(target, group)))
+          return (cond[first] != 0) == onTrue ? target[first] : pos + 3;
+      }
+      next.clear();
+      for (auto lane : group.lanes) {
+        const bool cond = Arg(lane, pos + 1, op.ParamA()) != 0;
+        next.emplace_back(cond == onTrue ? Arg(lane, pos + 2, op.ParamB())
+                                         : pos + 3);
+      }
+      return std::nullopt;
+    }
+
+    // The pending group at ptr, which is created if there isn't one.
+    Group& PendingAt(int64_t ptr) {
+      auto iter = std::find_if(
+        pending.begin(), pending.end(), [&](const Group& other) {
+          return other.insnPtr == ptr;
+        });
+      if (iter == pending.end())
+        iter = pending.insert(pending.end(), Group{ptr, {}});
+      return *iter;
+    }
+
+    // Moves every lane whose next instruction pointer differs from the first
+    // lane's into the pending group at its target.
+    void Split(Group& group, const std::vector<int64_t>& next) {
+      std::vector<uint32_t> stay;
+      for (size_t i = 0; i < group.lanes.size(); ++i) {
+        if (next[i] == next[0])
+          stay.emplace_back(group.lanes[i]);
+        else
+          PendingAt(next[i]).lanes.emplace_back(group.lanes[i]);
+      }
+      group.insnPtr = next[0];
+      group.lanes   = std::move(stay);
+    }
+
+    // Self-modifying code has given the lanes different opcodes. Lanes which
+    // disagree with the first are parked in new groups at the same address.
+    void SplitByOpcode(Group& group, const std::vector<int64_t>& words) {
+      std::vector<uint32_t> stay;
+      std::vector<std::pair<int64_t, Group>> others;
+      for (size_t i = 0; i < group.lanes.size(); ++i) {
+        if (words[i] == words[0]) {
+          stay.emplace_back(group.lanes[i]);
+          continue;
+        }
+        auto iter = std::find_if(
+          others.begin(), others.end(), [&](const auto& other) {
+            return other.first == words[i];
+          });
+        if (iter == others.end())
+          iter = others.insert(others.end(),
+                               {words[i], Group{group.insnPtr, {}}});
+        iter->second.lanes.emplace_back(group.lanes[i]);
+      }
+      for (auto& [word, other] : others)
+        pending.emplace_back(std::move(other));
+      group.lanes = std::move(stay);
+    }
+
+    void Stop(uint32_t lane, int64_t ptr, ExecState why) {
+      insnPtr[lane] = ptr;
+      state[lane]   = why;
+    }
+
+    // Runs one instruction for the group, emptying it if its lanes stop.
+    void Step(Group& group, std::vector<int64_t>& next) {
+      const auto pos = group.insnPtr;
+      const auto* words = Row(pos);
+      if (!Uniform(words, group)) {
+        next.clear();
+        for (auto lane : group.lanes)
+          next.emplace_back(words[lane]);
+        SplitByOpcode(group, next);
+      }
+      const Insn op{words[group.lanes.front()]};
+      switch (op.GetHandler()) {
+      case Insn::ADD:
+        Arithmetic(group, op, [](int64_t a, int64_t b) {
+          return static_cast<int64_t>(static_cast<uint64_t>(a) + b);
+        });
+        group.insnPtr += 4;
+        break;
+      case Insn::MULTIPLY:
+        Arithmetic(group, op, [](int64_t a, int64_t b) {
+          return static_cast<int64_t>(static_cast<uint64_t>(a) * b);
+        });
+        group.insnPtr += 4;
+        break;
+      case Insn::LESS_THAN:
+        Arithmetic(
+          group, op, [](int64_t a, int64_t b) -> int64_t { return a < b; });
+        group.insnPtr += 4;
+        break;
+      case Insn::EQUALS:
+        Arithmetic(
+          group, op, [](int64_t a, int64_t b) -> int64_t { return a == b; });
+        group.insnPtr += 4;
+        break;
+      case Insn::INPUT: {
+        std::vector<uint32_t> fed;
+        for (auto lane : group.lanes) {
+          if (input[lane].empty()) {
+            Stop(lane, pos, ExecState::NEED_INPUT);
+            continue;
+          }
+          MutableRow(Addr(lane, pos + 1, op.ParamA()))[lane] =
+            input[lane].front();
+          input[lane].pop();
+          fed.emplace_back(lane);
+        }
+        group.lanes = std::move(fed);
+        group.insnPtr += 2;
+        break;
+      }
+      case Insn::OUTPUT:
+        for (auto lane : group.lanes) {
+          out[lane] = Arg(lane, pos + 1, op.ParamA());
+          Stop(lane, pos + 2, ExecState::HAS_OUTPUT);
+        }
+        group.lanes.clear();
+        return;
+      case Insn::JUMP_IF_TRUE:
+      case Insn::JUMP_IF_FALSE:
+        if (auto target = Jump(group, op, next))
+          group.insnPtr = *target;
+        else
+          Split(group, next);
+        break;
+      case Insn::ADJUST_REL_PTR:
+        if (auto a = UniformAddr(group, pos + 1, op.ParamA())) {
+          const auto* row = Row(*a);
+          ForEachLane(group,
+                      [&](uint32_t lane) { relPtr[lane] += row[lane]; });
+        } else {
+          for (auto lane : group.lanes)
+            relPtr[lane] += Arg(lane, pos + 1, op.ParamA());
+        }
+        group.insnPtr += 2;
+        break;
+      case Insn::HALT:
+        for (auto lane : group.lanes)
+          Stop(lane, pos, ExecState::HALTED);
+        group.lanes.clear();
+        return;
+      default:
+        ++group.insnPtr;
+        break;
+      }
+    }
+
+   public:
+    IntCodeBatch(const std::vector<int64_t>& program, size_t lanes)
+      : lanes{lanes},
+        nearRows{static_cast<int64_t>(program.size())},
+        near(program.size() * lanes),
+        zeroes(lanes),
+        input(lanes),
+        insnPtr(lanes),
+        relPtr(lanes),
+        out(lanes),
+        state(lanes, ExecState::NEED_INPUT) {
+      if (lanes == 0)
+        throw std::invalid_argument{"IntCodeBatch needs at least one lane"};
+      for (size_t addr = 0; addr < program.size(); ++addr)
+        std::fill_n(near.begin() + addr * lanes, lanes, program[addr]);
+    }
+
+    [[nodiscard]] size_t Lanes() const noexcept { return lanes; }
+
+    [[nodiscard]] ExecState State(size_t lane) const { return state[lane]; }
+
+    [[nodiscard]] int64_t Out(size_t lane) const { return out[lane]; }
+
+    [[nodiscard]] int64_t Peek(size_t lane, int64_t addr) const {
+      return Read(lane, addr);
+    }
+
+    IntCodeBatch& Poke(size_t lane, int64_t addr, int64_t val) {
+      MutableRow(addr)[lane] = val;
+      return *this;
+    }
+
+    IntCodeBatch& PushInput(size_t lane, int64_t val) {
+      input[lane].push(val);
+      return *this;
+    }
+
+    // Runs every lane that hasn't halted until it halts, needs input or
+    // produces output, as one call to IntCodeComputer::Execute() would.
+    //
+    // Lanes which branch apart are merged again wherever they meet. The
+    // group furthest behind always runs, and only until it reaches or passes
+    // another, so lanes that took a short way round a branch wait at the
+    // join for those that took the long way.
+    void Execute() {
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        if (state[lane] != ExecState::HALTED)
+          PendingAt(insnPtr[lane]).lanes.emplace_back(lane);
+      }
+      std::vector<int64_t> next;
+      while (!pending.empty()) {
+        auto first = std::min_element(
+          pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+            return a.insnPtr < b.insnPtr;
+          });
+        auto group = std::move(*first);
+        pending.erase(first);
+        auto behind = [&] {
+          return std::any_of(
+            pending.begin(), pending.end(), [&](const Group& other) {
+              return other.insnPtr <= group.insnPtr;
+            });
+        };
+        Step(group, next);
+        while (!group.lanes.empty() && !behind())
+          Step(group, next);
+        if (!group.lanes.empty()) {
+          auto& joined = PendingAt(group.insnPtr).lanes;
+          joined.insert(joined.end(), group.lanes.begin(), group.lanes.end());
+        }
+      }
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEBATCH
@@ -0,0 +1,321 @@
+#ifndef AOC_UTIL_INTCODECLUSTER
+#define AOC_UTIL_INTCODECLUSTER
+
+#include "util/IntCode.h"
+#include "util/Parallel.h"
+#include "util/RingBuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace AoC {
+  // Runs many machines on a fixed pool of threads. Each worker has its own
+  // queue of runnable machines and steals from the others when it runs dry.
+  // A machine runs for at most one slice of instructions before going to the
+  // back of the queue, so a machine that never waits can't starve the rest.
+  //
+  // Machines talk through packets: every packetSize outputs are handed to
+  // the route callback, which typically Send()s them on to another machine.
+  // A machine that wants input with nothing in its inbox is parked until a
+  // packet arrives. Once every machine is parked or halted the cluster is
+  // idle and the idle callback runs with nothing else running; Run() returns
+  // if it sends nothing.
+  template <class Computer = IntCodeComputer>
+  class IntCodeCluster {
+   public:
+    // Called on worker threads, possibly concurrently, so it must only
+    // touch the cluster through Send() or guard its own state.
+    using Route = std::function<void(size_t from, std::span<const int64_t>)>;
+    using Idle  = std::function<void()>;
+
+    struct Stats {
+      uint64_t slices = 0;
+      uint64_t steals = 0;
+      uint64_t idles  = 0;
+    };
+
+   private:
+    enum class State : uint8_t { PARKED, QUEUED, RUNNING, HALTED };
+
+    struct Machine {
+      Computer comp;
+      size_t index;
+      std::mutex lock;
+      std::vector<int64_t> inbox;
+      State state = State::QUEUED;
+
+      Machine(Computer&& comp, size_t index)
+          : comp{std::move(comp)}, index{index} {}
+    };
+
+    struct Worker {
+      const IntCodeCluster* owner = nullptr;
+      std::mutex lock;
+      RingBuffer<Machine*> queue;
+      std::vector<int64_t> packet;
+      uint64_t slices = 0;
+      uint64_t steals = 0;
+    };
+
+    std::deque<Machine> machines;
+    std::deque<Worker> workers;
+    Route route;
+    Idle idle;
+    size_t packetSize;
+    uint64_t slice = 10000;
+    uint64_t idles = 0;
+
+    // Machines queued or running. Reaching zero means the cluster is idle.
+    std::atomic<size_t> active{0};
+    // Machines queued but not yet taken by a worker.
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> sleepers{0};
+    std::atomic<bool> done{false};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::mutex errorLock;
+    std::exception_ptr error;
+
+    static thread_local inline Worker* current = nullptr;
+
+    void Push(Worker& worker, Machine& machine) {
+      {
+        std::lock_guard guard{worker.lock};
+        worker.queue.Push(&machine);
+      }
+      pending.fetch_add(1);
+      if (sleepers.load()) {
+        std::lock_guard guard{sleepLock};
+        wake.notify_one();
+      }
+    }
+
+    [[nodiscard]] Machine* TryPop(Worker& worker) {
+      std::lock_guard guard{worker.lock};
+      if (worker.queue.Empty())
+        return nullptr;
+      pending.fetch_sub(1);
+      return worker.queue.Pop();
+    }
+
+    // Own queue first, then every other worker's in turn.
+    [[nodiscard]] Machine* Take(size_t self) {
+      if (auto* machine = TryPop(workers[self]))
+        return machine;
+      for (size_t i = 1; i < workers.size(); ++i) {
+        if (auto* machine = TryPop(workers[(self + i) % workers.size()])) {
+          ++workers[self].steals;
+          return machine;
+        }
+      }
+      return nullptr;
+    }
+
+    void Stop() {
+      std::lock_guard guard{sleepLock};
+      done = true;
+      wake.notify_all();
+    }
+
+    void Fail(std::exception_ptr err) {
+      {
+        std::lock_guard guard{errorLock};
+        if (!error)
+          error = err;
+      }
+      Stop();
+    }
+
+    // Called when a machine stops being queued or running. The last one to
+    // do so runs the idle callback, which nothing else can race with.
+    void Retire() {
+      if (active.fetch_sub(1) != 1)
+        return;
+      ++idles;
+      if (idle)
+        idle();
+      if (!active.load())
+        Stop();
+    }
+
+    // Runs machine for one slice, routing packets as they complete.
+    void RunSlice(Worker& worker, Machine& machine) {
+      ++worker.slices;
+      auto budget = slice;
+      while (true) {
+        const auto state = machine.comp.RunFor(budget, packetSize);
+        if (!state) {
+          Push(worker, machine);
+          return;
+        }
+        switch (*state) {
+        case ExecState::HAS_OUTPUT:
+          for (auto& val : worker.packet)
+            val = machine.comp.PopOutput();
+          route(machine.index, worker.packet);
+          continue;
+        case ExecState::NEED_INPUT: {
+          std::lock_guard guard{machine.lock};
+          if (!machine.inbox.empty()) {
+            for (auto val : machine.inbox)
+              machine.comp.PushInput(val);
+            machine.inbox.clear();
+            continue;
+          }
+          machine.state = State::PARKED;
+          break;
+        }
+        case ExecState::HALTED: {
+          std::lock_guard guard{machine.lock};
+          machine.state = State::HALTED;
+          break;
+        }
+        }
+        Retire();
+        return;
+      }
+    }
+
+    void Work(size_t self) {
+      current = &workers[self];
+      while (!done) {
+        auto* machine = Take(self);
+        if (!machine) {
+          std::unique_lock guard{sleepLock};
+          sleepers.fetch_add(1);
+          wake.wait(guard, [&] { return done || pending.load(); });
+          sleepers.fetch_sub(1);
+          continue;
+        }
+        {
+          std::lock_guard guard{machine->lock};
+          machine->state = State::RUNNING;
+          for (auto val : machine->inbox)
+            machine->comp.PushInput(val);
+          machine->inbox.clear();
+        }
+        try {
+          RunSlice(workers[self], *machine);
+        } catch (...) {
+          Fail(std::current_exception());
+        }
+      }
+      current = nullptr;
+    }
+
+   public:
+    // Every packetSize outputs of a machine make up one packet.
+    IntCodeCluster(size_t packetSize, Route route)
+        : route{std::move(route)}, packetSize{packetSize} {
+      if (!packetSize)
+        throw std::invalid_argument{"Packet size must be at least 1"};
+    }
+
+    IntCodeCluster(const IntCodeCluster&) = delete;
+    IntCodeCluster& operator=(const IntCodeCluster&) = delete;
+
+    // Adds a machine, which starts runnable. Use Fork() to add many copies
+    // of one program cheaply. Returns its index.
+    size_t Add(Computer comp) {
+      machines.emplace_back(std::move(comp), machines.size());
+      return machines.size() - 1;
+    }
+
+    // Queues vals as input to machine index and wakes it if it is parked.
+    // Call it from the route and idle callbacks or while Run() isn't
+    // running, never from another thread during Run().
+    void Send(size_t index, std::span<const int64_t> vals) {
+      auto& machine = machines.at(index);
+      {
+        std::lock_guard guard{machine.lock};
+        machine.inbox.insert(machine.inbox.end(), vals.begin(), vals.end());
+        if (machine.state != State::PARKED)
+          return;
+        machine.state = State::QUEUED;
+      }
+      // Outside Run() the machine is picked up when Run() starts.
+      if (!current || current->owner != this)
+        return;
+      active.fetch_add(1);
+      Push(*current, machine);
+    }
+
+    void Send(size_t index, std::initializer_list<int64_t> vals) {
+      Send(index, std::span<const int64_t>{vals.begin(), vals.size()});
+    }
+
+    void SetIdle(Idle callback) { idle = std::move(callback); }
+
+    // Instructions a machine may run before yielding to the next.
+    void SetSlice(uint64_t instructions) { slice = instructions; }
+
+    // Runs every queued machine on threads workers, or one per core if 0,
+    // until the cluster is idle and the idle callback sent nothing. The
+    // calling thread is one of the workers. The first exception thrown by a
+    // machine or a callback stops every worker and is rethrown here.
+    void Run(size_t threads = 0) {
+      workers.clear();
+      const auto count = threads ? threads : WorkerCount(machines.size());
+      for (size_t i = 0; i < count; ++i)
+        workers.emplace_back();
+      size_t queued = 0;
+      for (auto& machine : machines) {
+        if (machine.state == State::QUEUED)
+          workers[queued++ % workers.size()].queue.Push(&machine);
+      }
+      for (auto& worker : workers) {
+        worker.owner = this;
+        worker.packet.resize(packetSize);
+      }
+      idles   = 0;
+      active  = queued;
+      pending = queued;
+      done    = !queued;
+      error   = nullptr;
+      std::vector<std::thread> threadPool;
+      threadPool.reserve(workers.size() - 1);
+      for (size_t worker = 1; worker < workers.size(); ++worker)
+        threadPool.emplace_back([this, worker] { Work(worker); });
+      Work(0);
+      for (auto& thread : threadPool)
+        thread.join();
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+    [[nodiscard]] size_t Size() const noexcept { return machines.size(); }
+
+    [[nodiscard]] Computer& Get(size_t index) {
+      return machines.at(index).comp;
+    }
+
+    [[nodiscard]] bool Halted(size_t index) const {
+      return machines.at(index).state == State::HALTED;
+    }
+
+    // Totals for the last Run().
+    [[nodiscard]] Stats GetStats() const {
+      Stats ret;
+      for (auto& worker : workers) {
+        ret.slices += worker.slices;
+        ret.steals += worker.steals;
+      }
+      ret.idles = idles;
+      return ret;
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODECLUSTER
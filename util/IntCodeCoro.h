@@ -0,0 +1,184 @@
+#ifndef AOC_UTIL_INTCODECORO
+#define AOC_UTIL_INTCODECORO
+
+#include "util/IntCode.h"
+#include "util/RingBuffer.h"
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+// Coroutine front-end for Intcode. Driver code is written as an IntCodeTask
+// that co_awaits device.Read() for the next output of a machine and
+// device.Write(val) to give it input. An IntCodeScheduler only runs machines
+// which a task is waiting on and which aren't stuck waiting for input, and
+// resumes each task once the output it wants exists. Awaiting never
+// allocates; a task's frame is allocated once when it is created.
+namespace AoC {
+  class IntCodeScheduler;
+
+  // A coroutine driving one or more devices. It starts running as soon as
+  // it is called and owns its frame until destroyed.
+  class IntCodeTask {
+   public:
+    struct promise_type {
+      std::exception_ptr error;
+
+      IntCodeTask get_return_object() {
+        return IntCodeTask{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept {
+        error = std::current_exception();
+      }
+    };
+
+   private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit IntCodeTask(std::coroutine_handle<promise_type> handle)
+        : handle{handle} {}
+
+   public:
+    IntCodeTask(IntCodeTask&& rhs) noexcept
+        : handle{std::exchange(rhs.handle, nullptr)} {}
+    IntCodeTask& operator=(IntCodeTask&& rhs) noexcept {
+      std::swap(handle, rhs.handle);
+      return *this;
+    }
+    ~IntCodeTask() {
+      if (handle)
+        handle.destroy();
+    }
+
+    [[nodiscard]] bool Done() const noexcept { return handle.done(); }
+
+    // Rethrows anything the task threw. A task which never finished is
+    // still waiting on a machine that can't run, so that is an error too.
+    void Get() const {
+      if (!handle.done())
+        throw std::runtime_error{"Intcode task is deadlocked"};
+      if (handle.promise().error)
+        std::rethrow_exception(handle.promise().error);
+    }
+  };
+
+  // The part of a device the scheduler needs, independent of the machine
+  // behind it.
+  class IntCodeDeviceBase {
+    friend class IntCodeScheduler;
+
+    IntCodeScheduler& scheduler;
+    std::coroutine_handle<> reader;
+    bool blocked = false;
+    bool halted  = false;
+    bool queued  = false;
+
+    virtual ExecState RunMachine()         = 0;
+    [[nodiscard]] virtual bool HasOutput() = 0;
+    [[nodiscard]] virtual int64_t Output() = 0;
+    virtual void Input(int64_t val)        = 0;
+
+    void Wake();
+
+   protected:
+    explicit IntCodeDeviceBase(IntCodeScheduler& scheduler)
+        : scheduler{scheduler} {}
+    IntCodeDeviceBase(const IntCodeDeviceBase&) = delete;
+    IntCodeDeviceBase& operator=(const IntCodeDeviceBase&) = delete;
+    virtual ~IntCodeDeviceBase()                           = default;
+
+   public:
+    class ReadAwaiter {
+      IntCodeDeviceBase& device;
+
+     public:
+      explicit ReadAwaiter(IntCodeDeviceBase& device) : device{device} {}
+
+      [[nodiscard]] bool await_ready() {
+        return device.HasOutput() || device.halted;
+      }
+      void await_suspend(std::coroutine_handle<> task) {
+        if (device.reader)
+          throw std::logic_error{"Intcode device already has a reader"};
+        device.reader = task;
+        device.Wake();
+      }
+      [[nodiscard]] std::optional<int64_t> await_resume() {
+        if (device.HasOutput())
+          return device.Output();
+        return std::nullopt;
+      }
+    };
+
+    // The machine's next output, or nullopt once it has halted.
+    [[nodiscard]] ReadAwaiter Read() { return ReadAwaiter{*this}; }
+
+    // Input never waits: it is queued and the machine may run again.
+    [[nodiscard]] std::suspend_never Write(int64_t val) {
+      Input(val);
+      blocked = false;
+      Wake();
+      return {};
+    }
+  };
+
+  template <class Computer = IntCodeComputer>
+  class IntCodeDevice : public IntCodeDeviceBase {
+    Computer& comp;
+
+    ExecState RunMachine() override { return comp.RunUntil(1); }
+    bool HasOutput() override { return comp.OutputCount() != 0; }
+    int64_t Output() override { return comp.PopOutput(); }
+    void Input(int64_t val) override { comp.PushInput(val); }
+
+   public:
+    IntCodeDevice(IntCodeScheduler& scheduler, Computer& comp)
+        : IntCodeDeviceBase{scheduler}, comp{comp} {}
+  };
+
+  // Runs devices in the order they became ready. Only a device with a
+  // waiting reader, which isn't blocked on input, is ever queued.
+  class IntCodeScheduler {
+    friend class IntCodeDeviceBase;
+
+    RingBuffer<IntCodeDeviceBase*> ready;
+
+   public:
+    // Returns once no device can make progress.
+    void Run() {
+      while (!ready.Empty()) {
+        auto& device  = *ready.Pop();
+        device.queued = false;
+        if (!device.reader)
+          continue;
+        switch (device.RunMachine()) {
+        case ExecState::NEED_INPUT:
+          device.blocked = true;
+          continue;
+        case ExecState::HALTED:
+          device.halted = true;
+          break;
+        case ExecState::HAS_OUTPUT:
+          break;
+        }
+        std::exchange(device.reader, nullptr).resume();
+      }
+    }
+  };
+
+  inline void IntCodeDeviceBase::Wake() {
+    if (queued || blocked || halted || !reader)
+      return;
+    queued = true;
+    scheduler.ready.Push(this);
+  }
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODECORO
@@ -0,0 +1,180 @@
+#ifndef AOC_UTIL_INTCODEDAEMON
+#define AOC_UTIL_INTCODEDAEMON
+
+#include "util/IntCodeInsn.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// The protocol between intcode_daemon and its clients, over a Unix stream
+// socket. Every message either way is a frame of int64 words in host byte
+// order: a request type or reply status, a payload length, then the
+// payload.
+//
+//   LOAD  <program image>  -> OK <hash>   caches the program
+//   START <hash>           -> OK          gives this connection a fresh VM
+//   RUN   <inputs>         -> <state> <outputs>
+//
+// RUN queues the inputs and runs until the program wants more, halts, or
+// has produced INTCODE_OUTPUT_CHUNK outputs, replying with the ExecState it
+// stopped in. A client streams input and output by sending RUN again, with
+// no inputs to just collect more output. Each RUN executes at most the
+// daemon's instruction budget, replying BUDGET with any outputs so far if
+// it runs out; RUN again resumes, or the client may just hang up. The
+// daemon only caches so many programs, dropping the least recently used,
+// so START can fail with an unknown hash and need another LOAD. Any
+// request can fail with ERROR, with the message as one character per word.
+// Both ends should ignore SIGPIPE.
+namespace AoC {
+  enum class IntCodeRequest : int64_t { LOAD = 1, START, RUN };
+
+  // Replies to RUN are an ExecState; these follow on from it.
+  constexpr int64_t INTCODE_REPLY_OK     = 3;
+  constexpr int64_t INTCODE_REPLY_ERROR  = 4;
+  constexpr int64_t INTCODE_REPLY_BUDGET = 5;
+
+  constexpr size_t INTCODE_OUTPUT_CHUNK = 4096;
+
+  // A connected socket which sends and receives whole frames.
+  class IntCodeSocket {
+    static constexpr uint64_t MAX_PAYLOAD = uint64_t{1} << 26;
+
+    int fd = -1;
+    std::vector<int64_t> scratch;
+
+    // False on a clean end of stream before the first byte.
+    bool ReadAll(void* buf, size_t len) {
+      auto* pos = static_cast<char*>(buf);
+      for (size_t done = 0; done < len;) {
+        const auto got = read(fd, pos + done, len - done);
+        if (got == 0 && done == 0)
+          return false;
+        if (got == 0)
+          throw std::runtime_error{"Intcode socket closed mid-frame"};
+        if (got < 0 && errno != EINTR)
+          throw std::runtime_error{std::string{"Intcode socket: "} +
+                                   std::strerror(errno)};
+        done += got > 0 ? got : 0;
+      }
+      return true;
+    }
+
+   public:
+    IntCodeSocket() = default;
+    explicit IntCodeSocket(int fd) : fd{fd} {}
+    IntCodeSocket(IntCodeSocket&& rhs) noexcept
+        : fd{std::exchange(rhs.fd, -1)} {}
+    IntCodeSocket& operator=(IntCodeSocket&& rhs) noexcept {
+      std::swap(fd, rhs.fd);
+      return *this;
+    }
+    ~IntCodeSocket() {
+      if (fd >= 0)
+        close(fd);
+    }
+
+    // Connects to the daemon listening at path.
+    [[nodiscard]] static IntCodeSocket Connect(const std::string& path) {
+      IntCodeSocket ret{socket(AF_UNIX, SOCK_STREAM, 0)};
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      if (ret.fd < 0 || path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error{"Bad Intcode socket path " + path};
+      std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+      if (connect(ret.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+        throw std::runtime_error{"Could not connect to " + path};
+      return ret;
+    }
+
+    void Send(int64_t type, std::span<const int64_t> payload) {
+      scratch.assign({type, static_cast<int64_t>(payload.size())});
+      scratch.insert(scratch.end(), payload.begin(), payload.end());
+      const auto* pos = reinterpret_cast<const char*>(scratch.data());
+      const auto len  = scratch.size() * sizeof(int64_t);
+      for (size_t done = 0; done < len;) {
+        const auto sent = write(fd, pos + done, len - done);
+        if (sent < 0 && errno != EINTR)
+          throw std::runtime_error{std::string{"Intcode socket: "} +
+                                   std::strerror(errno)};
+        done += sent > 0 ? sent : 0;
+      }
+    }
+
+    // Reads the next frame into type and payload. Returns false if the peer
+    // closed the connection instead.
+    bool Receive(int64_t& type, std::vector<int64_t>& payload) {
+      int64_t head[2];
+      if (!ReadAll(head, sizeof(head)))
+        return false;
+      if (head[1] < 0 || static_cast<uint64_t>(head[1]) > MAX_PAYLOAD)
+        throw std::runtime_error{"Intcode frame too large"};
+      type = head[0];
+      payload.resize(head[1]);
+      if (!payload.empty() &&
+          !ReadAll(payload.data(), payload.size() * sizeof(int64_t)))
+        throw std::runtime_error{"Intcode socket closed mid-frame"};
+      return true;
+    }
+  };
+
+  // A client of intcode_daemon, driving one VM at a time.
+  class IntCodeClient {
+    IntCodeSocket sock;
+    std::vector<int64_t> reply;
+
+    int64_t Call(IntCodeRequest request, std::span<const int64_t> payload) {
+      sock.Send(static_cast<int64_t>(request), payload);
+      int64_t status = 0;
+      if (!sock.Receive(status, reply))
+        throw std::runtime_error{"Intcode daemon hung up"};
+      if (status == INTCODE_REPLY_ERROR)
+        throw std::runtime_error{"Intcode daemon: " +
+                                 std::string(reply.begin(), reply.end())};
+      return status;
+    }
+
+   public:
+    explicit IntCodeClient(const std::string& path)
+        : sock{IntCodeSocket::Connect(path)} {}
+
+    // Caches program in the daemon and returns its hash for Start().
+    [[nodiscard]] uint64_t Load(const std::vector<int64_t>& program) {
+      Call(IntCodeRequest::LOAD, program);
+      return static_cast<uint64_t>(reply.at(0));
+    }
+
+    void Start(uint64_t hash) {
+      const int64_t payload[] = {static_cast<int64_t>(hash)};
+      Call(IntCodeRequest::START, payload);
+    }
+
+    // Sends inputs and appends whatever the VM outputs before it stops.
+    // Nothing if it used up its instruction budget, in which case another
+    // Run() carries on.
+    std::optional<ExecState> Run(std::span<const int64_t> inputs,
+                                 std::vector<int64_t>& outputs) {
+      const auto status = Call(IntCodeRequest::RUN, inputs);
+      if (status != INTCODE_REPLY_BUDGET &&
+          (status < 0 || status >= INTCODE_REPLY_OK))
+        throw std::runtime_error{"Intcode daemon sent a bad reply"};
+      outputs.insert(outputs.end(), reply.begin(), reply.end());
+      if (status == INTCODE_REPLY_BUDGET)
+        return std::nullopt;
+      return static_cast<ExecState>(status);
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEDAEMON
@@ -0,0 +1,195 @@
+#ifndef AOC_UTIL_INTCODEFLAT
+#define AOC_UTIL_INTCODEFLAT
+
+#include "util/IntCode.h"
+#include "util/RingBuffer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace AoC {
+  // The state and slow path shared by engines that run Intcode as native
+  // code: memory is one flat array, so generated code can address it
+  // directly, with a map for the rare far address. Words that native code
+  // was generated from are flagged in code; writing one calls CodeWritten
+  // before the word changes. Step interprets a single instruction, for
+  // whatever the native code can't run. Derived engines supply Run.
+  class IntCodeFlatMachine {
+   protected:
+    static constexpr int64_t FLAT_LIMIT = int64_t{1} << 24;
+
+    std::vector<int64_t> mem;
+    std::unordered_map<int64_t, int64_t> far;
+    std::vector<uint8_t> code;
+    RingBuffer<int64_t> input;
+    RingBuffer<int64_t> output;
+    size_t outputsWanted = 1;
+    int64_t insnPtr      = 0;
+    int64_t relPtr       = 0;
+    int64_t out          = 0;
+
+    explicit IntCodeFlatMachine(const std::vector<int64_t>& program) {
+      Grow(std::max<int64_t>(program.size(), 1));
+      std::copy(program.begin(), program.end(), mem.begin());
+    }
+
+    IntCodeFlatMachine(const IntCodeFlatMachine&) = default;
+    IntCodeFlatMachine& operator=(const IntCodeFlatMachine&) = default;
+    virtual ~IntCodeFlatMachine()                            = default;
+
+    virtual ExecState Run()                = 0;
+    virtual void CodeWritten(int64_t addr) = 0;
+    // Called after the flat array is resized to size words.
+    virtual void Grown(int64_t size) { static_cast<void>(size); }
+
+    [[nodiscard]] int64_t Read(int64_t addr) const {
+      if (addr < 0)
+        throw std::out_of_range{"Negative Intcode address"};
+      if (addr < static_cast<int64_t>(mem.size()))
+        return mem[addr];
+      auto iter = far.find(addr);
+      return iter == far.end() ? 0 : iter->second;
+    }
+
+    void Write(int64_t addr, int64_t val) {
+      if (addr < 0)
+        throw std::out_of_range{"Negative Intcode address"};
+      if (addr >= static_cast<int64_t>(mem.size())) {
+        if (addr >= FLAT_LIMIT) {
+          far[addr] = val;
+          return;
+        }
+        Grow(std::max<int64_t>(addr + 1, mem.size() * 2));
+      }
+      if (code[addr])
+        CodeWritten(addr);
+      mem[addr] = val;
+    }
+
+    void Grow(int64_t size) {
+      size           = std::min(size, FLAT_LIMIT);
+      const auto old = static_cast<int64_t>(mem.size());
+      mem.resize(size);
+      code.resize(size);
+      for (auto iter = far.begin(); iter != far.end();) {
+        if (iter->first >= old && iter->first < size) {
+          mem[iter->first] = iter->second;
+          iter             = far.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+      Grown(size);
+    }
+
+    int64_t Addr(int64_t pos, ParamMode mode) const {
+      switch (mode) {
+      case ParamMode::POSITION:
+        return Read(pos);
+      case ParamMode::IMMEDIATE:
+        return pos;
+      case ParamMode::RELATIVE:
+        return Read(pos) + relPtr;
+      }
+      return pos;
+    }
+
+    int64_t Arg(int64_t pos, ParamMode mode) const {
+      return Read(Addr(pos, mode));
+    }
+
+    // Interprets one instruction, returning a state if execution stops.
+    std::optional<ExecState> Step() {
+      const auto pos = insnPtr;
+      const Insn op{Read(pos)};
+      switch (op.GetHandler()) {
+      case Insn::ADD:
+      case Insn::MULTIPLY:
+      case Insn::LESS_THAN:
+      case Insn::EQUALS: {
+        const auto a = Arg(pos + 1, op.ParamA());
+        const auto b = Arg(pos + 2, op.ParamB());
+        int64_t val  = 0;
+        if (op.GetHandler() == Insn::ADD)
+          val = a + b;
+        else if (op.GetHandler() == Insn::MULTIPLY)
+          val = a * b;
+        else if (op.GetHandler() == Insn::LESS_THAN)
+          val = a < b;
+        else
+          val = a == b;
+        Write(Addr(pos + 3, op.ParamC()), val);
+        insnPtr = pos + 4;
+        return std::nullopt;
+      }
+      case Insn::INPUT:
+        if (input.Empty())
+          return ExecState::NEED_INPUT;
+        Write(Addr(pos + 1, op.ParamA()), input.Pop());
+        insnPtr = pos + 2;
+        return std::nullopt;
+      case Insn::OUTPUT:
+        output.Push(out = Arg(pos + 1, op.ParamA()));
+        insnPtr = pos + 2;
+        if (output.Size() >= outputsWanted)
+          return ExecState::HAS_OUTPUT;
+        return std::nullopt;
+      case Insn::JUMP_IF_TRUE:
+      case Insn::JUMP_IF_FALSE: {
+        const bool cond = Arg(pos + 1, op.ParamA()) != 0;
+        const auto dest = Arg(pos + 2, op.ParamB());
+        insnPtr = cond == (op.GetHandler() == Insn::JUMP_IF_TRUE) ? dest
+                                                                  : pos + 3;
+        return std::nullopt;
+      }
+      case Insn::ADJUST_REL_PTR:
+        relPtr += Arg(pos + 1, op.ParamA());
+        insnPtr = pos + 2;
+        return std::nullopt;
+      case Insn::HALT:
+        return ExecState::HALTED;
+      default:
+        insnPtr = pos + 1;
+        return std::nullopt;
+      }
+    }
+
+   public:
+    [[nodiscard]] int64_t Peek(int64_t addr) const { return Read(addr); }
+
+    IntCodeFlatMachine& Poke(int64_t addr, int64_t val) {
+      Write(addr, val);
+      return *this;
+    }
+
+    [[nodiscard]] int64_t Out() const noexcept { return out; }
+
+    [[nodiscard]] size_t OutputCount() const noexcept { return output.Size(); }
+
+    int64_t PopOutput() { return output.Pop(); }
+
+    IntCodeFlatMachine& PushInput(int64_t val) {
+      input.Push(val);
+      return *this;
+    }
+
+    [[nodiscard]] ExecState RunUntil(size_t outputsWanted) {
+      this->outputsWanted = outputsWanted ? outputsWanted : SIZE_MAX;
+      if (output.Size() >= this->outputsWanted)
+        return ExecState::HAS_OUTPUT;
+      return Run();
+    }
+
+    [[nodiscard]] ExecState Execute() {
+      output.Clear();
+      return RunUntil(1);
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEFLAT
@@ -0,0 +1,111 @@
+#ifndef AOC_UTIL_INTCODEINSN
+#define AOC_UTIL_INTCODEINSN
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace AoC {
+  enum class ParamMode : uint8_t {
+    POSITION,
+    IMMEDIATE,
+    RELATIVE,
+  };
+
+  enum class ExecState { NEED_INPUT, HAS_OUTPUT, HALTED };
+
+  // SWITCH shares one indirect branch between every opcode. THREADED jumps
+  // from each handler to the next one, although GCC merges those jumps into
+  // a few shared ones, so the branch predictor gains less than the name
+  // suggests. It isn't always faster: see bench_intcode_dispatch. It falls
+  // back to SWITCH where unsupported.
+  enum class Dispatch { SWITCH, THREADED };
+
+  // A decoded instruction word. These are cached per address so the divisions
+  // and mode checks only happen the first time an address is executed. A
+  // default-constructed Insn has the DECODE handler and doubles as the "not
+  // decoded yet" marker.
+  //
+  // The handlers after UNKNOWN are superinstructions, which only ever appear
+  // in IntCodeComputer's decode cache, where the loader installs them. Each
+  // keeps the modes of its first instruction; the instructions after it come
+  // from the cache.
+  class Insn {
+   public:
+    // Dense opcode numbering for dispatch tables.
+    enum Handler : uint8_t {
+      DECODE,
+      ADD,
+      MULTIPLY,
+      INPUT,
+      OUTPUT,
+      JUMP_IF_TRUE,
+      JUMP_IF_FALSE,
+      LESS_THAN,
+      EQUALS,
+      ADJUST_REL_PTR,
+      HALT,
+      UNKNOWN,
+      LESS_THAN_JUMP,
+      EQUALS_JUMP,
+      ADD_JUMP,
+      ADJUST_ADD,
+      ADD_ADD_JUMP,
+    };
+    static constexpr size_t HANDLERS = ADD_ADD_JUMP + 1;
+
+   private:
+    Handler handler  = DECODE;
+    ParamMode paramA = ParamMode::POSITION;
+    ParamMode paramB = ParamMode::POSITION;
+    ParamMode paramC = ParamMode::POSITION;
+
+    static ParamMode GetMode(int64_t val) {
+      switch (val) {
+      case 0:
+        return ParamMode::POSITION;
+      case 1:
+        return ParamMode::IMMEDIATE;
+      case 2:
+        return ParamMode::RELATIVE;
+      }
+      throw std::runtime_error{"Invalid ParamMode"};
+    }
+
+   public:
+    Insn() = default;
+    explicit Insn(int64_t op) {
+      handler = UNKNOWN;
+      if (op < 0)
+        return;
+      const auto opCode = op % 100;
+      paramA            = GetMode((op / 100) % 10);
+      paramB            = GetMode((op / 1000) % 10);
+      paramC            = GetMode((op / 10000) % 10);
+      if (opCode >= ADD && opCode <= ADJUST_REL_PTR)
+        handler = static_cast<Handler>(opCode);
+      else if (opCode == 99)
+        handler = HALT;
+    }
+    // The same instruction run by another handler, for superinstructions.
+    [[nodiscard]] Insn WithHandler(Handler handler) const noexcept {
+      auto ret    = *this;
+      ret.handler = handler;
+      return ret;
+    }
+
+    // Whether every field holds one of its enumerators, which is only in
+    // doubt for an Insn read back from a file.
+    [[nodiscard]] bool Valid() const noexcept {
+      return handler < HANDLERS && paramA <= ParamMode::RELATIVE &&
+             paramB <= ParamMode::RELATIVE && paramC <= ParamMode::RELATIVE;
+    }
+
+    [[nodiscard]] Handler GetHandler() const noexcept { return handler; }
+    [[nodiscard]] ParamMode ParamA() const noexcept { return paramA; }
+    [[nodiscard]] ParamMode ParamB() const noexcept { return paramB; }
+    [[nodiscard]] ParamMode ParamC() const noexcept { return paramC; }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEINSN
@@ -0,0 +1,459 @@
+#ifndef AOC_UTIL_INTCODEJIT
+#define AOC_UTIL_INTCODEJIT
+
+#include "util/IntCode.h"
+#include "util/IntCodeFlat.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+// Native code generation needs x86-64 and POSIX mmap/mprotect.
+#  define AOC_INTCODE_JIT
+#  include <sys/mman.h>
+#endif
+
+namespace AoC {
+  // Memory and registers shared between the dispatcher and compiled blocks.
+  // The generated code addresses these fields by offset.
+  struct IntCodeJitContext {
+    int64_t* mem;
+    uint64_t size;
+    const uint8_t* code;
+    int64_t relPtr;
+    int64_t insnPtr;
+  };
+
+#ifdef AOC_INTCODE_JIT
+  // Executable memory for compiled blocks. Kept writable only while a block
+  // is being copied in.
+  class JitCodeBuffer {
+    uint8_t* base  = nullptr;
+    size_t size    = 0;
+    size_t used    = 0;
+
+   public:
+    explicit JitCodeBuffer(size_t size) : size{size} {
+      void* mem = mmap(nullptr,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1,
+                       0);
+      if (mem != MAP_FAILED)
+        base = static_cast<uint8_t*>(mem);
+    }
+    JitCodeBuffer(const JitCodeBuffer&) = delete;
+    JitCodeBuffer& operator=(const JitCodeBuffer&) = delete;
+    ~JitCodeBuffer() {
+      if (base)
+        munmap(base, size);
+    }
+
+    [[nodiscard]] bool Valid() const noexcept { return base != nullptr; }
+
+    // Copies code in and returns where it landed, or null if it's full.
+    [[nodiscard]] const uint8_t* Add(const std::vector<uint8_t>& code) {
+      if (!base || code.size() > size - used)
+        return nullptr;
+      if (mprotect(base, size, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+      auto* ret = base + used;
+      std::memcpy(ret, code.data(), code.size());
+      used += (code.size() + 15) & ~size_t{15};
+      if (mprotect(base, size, PROT_READ | PROT_EXEC) != 0)
+        throw std::runtime_error{"Could not make JIT code executable"};
+      return ret;
+    }
+
+    void Clear() noexcept { used = 0; }
+  };
+
+  // Translates a straight-line run of Intcode into x86-64. Registers while a
+  // block runs: rdi the context, r8 memory, r9 its size in words, r10 the
+  // code map, r11 the relative base; rax, rcx and rdx are scratch. Every
+  // access is bounds checked and every store checks the code map, leaving
+  // through a stub that hands the instruction to the interpreter instead of
+  // performing it.
+  class IntCodeJitCompiler {
+   public:
+    enum Exit : int { JUMP, INTERPRET };
+
+   private:
+    static constexpr size_t MAX_BLOCK_INSNS = 512;
+    static constexpr int64_t MAX_DISP_ADDR  = (int64_t{1} << 28) - 1;
+
+    enum Reg : uint8_t { RAX, RCX };
+
+    const std::vector<int64_t>& mem;
+    const std::vector<uint8_t>& dirty;
+    std::vector<uint8_t> buf;
+    // Fixups for jumps to the interpreter stub of an instruction.
+    std::vector<std::pair<size_t, int64_t>> stubJumps;
+    std::vector<size_t> epilogueJumps;
+    // Where each compiled instruction starts, for backward branches.
+    std::unordered_map<int64_t, size_t> labels;
+
+    void Emit(std::initializer_list<uint8_t> bytes) {
+      buf.insert(buf.end(), bytes);
+    }
+
+    void Emit32(int64_t val) {
+      const auto v = static_cast<uint32_t>(val);
+      Emit({static_cast<uint8_t>(v),
+            static_cast<uint8_t>(v >> 8),
+            static_cast<uint8_t>(v >> 16),
+            static_cast<uint8_t>(v >> 24)});
+    }
+
+    void Patch32(size_t at, int64_t val) {
+      const auto v = static_cast<uint32_t>(val);
+      for (auto i = 0; i < 4; ++i)
+        buf[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    static bool Fits32(int64_t val) {
+      return val >= INT32_MIN && val <= INT32_MAX;
+    }
+
+    // jcc rel32 to the stub which interprets the instruction at pos.
+    void JumpToStub(uint8_t cc, int64_t pos) {
+      Emit({0x0F, cc});
+      stubJumps.emplace_back(buf.size(), pos);
+      Emit32(0);
+    }
+
+    void JumpToEpilogue() {
+      Emit({0xE9});
+      epilogueJumps.emplace_back(buf.size());
+      Emit32(0);
+    }
+
+    // mov qword [rdi + insnPtr], imm32; mov eax, exit; jmp epilogue
+    void ExitTo(int64_t pos, Exit exit) {
+      Emit({0x48, 0xC7, 0x47, offsetof(IntCodeJitContext, insnPtr)});
+      Emit32(pos);
+      Emit({0xB8});
+      Emit32(exit);
+      JumpToEpilogue();
+    }
+
+    // rdx = r11 + word, then bounds checked against r9.
+    void RelativeAddr(int64_t word, int64_t pos) {
+      Emit({0x4C, 0x89, 0xDA}); // mov rdx, r11
+      Emit({0x48, 0x81, 0xC2}); // add rdx, imm32
+      Emit32(word);
+      Emit({0x4C, 0x39, 0xCA}); // cmp rdx, r9
+      JumpToStub(0x83, pos);    // jae
+    }
+
+    [[nodiscard]] bool InBounds(int64_t addr) const {
+      return addr >= 0 && addr < static_cast<int64_t>(mem.size()) &&
+             addr <= MAX_DISP_ADDR;
+    }
+
+    // Loads a parameter into reg. Fails if it can't be compiled, which ends
+    // the block.
+    [[nodiscard]] bool Load(Reg reg, ParamMode mode, int64_t pos, int64_t at) {
+      const auto word = mem[at];
+      switch (mode) {
+      case ParamMode::IMMEDIATE:
+        if (Fits32(word)) {
+          Emit({0x48, 0xC7, static_cast<uint8_t>(0xC0 | reg)});
+          Emit32(word);
+        } else {
+          Emit({0x48, static_cast<uint8_t>(0xB8 | reg)});
+          Emit32(word);
+          Emit32(static_cast<uint64_t>(word) >> 32);
+        }
+        return true;
+      case ParamMode::POSITION:
+        if (!InBounds(word))
+          return false;
+        Emit({0x49, 0x8B, static_cast<uint8_t>(0x80 | (reg << 3))});
+        Emit32(word * 8);
+        return true;
+      case ParamMode::RELATIVE:
+        if (!Fits32(word))
+          return false;
+        RelativeAddr(word, pos);
+        Emit({0x49, 0x8B, static_cast<uint8_t>(0x04 | (reg << 3)), 0xD0});
+        return true;
+      }
+      return false;
+    }
+
+    // Stores rax, unless the target holds compiled code.
+    [[nodiscard]] bool Store(ParamMode mode, int64_t pos, int64_t at) {
+      const auto word = mem[at];
+      switch (mode) {
+      case ParamMode::IMMEDIATE:
+        return false;
+      case ParamMode::POSITION:
+        if (!InBounds(word))
+          return false;
+        Emit({0x41, 0xF6, 0x82}); // test byte [r10 + disp32], 1
+        Emit32(word);
+        Emit({0x01});
+        JumpToStub(0x85, pos);    // jnz
+        Emit({0x49, 0x89, 0x80}); // mov [r8 + disp32], rax
+        Emit32(word * 8);
+        return true;
+      case ParamMode::RELATIVE:
+        if (!Fits32(word))
+          return false;
+        RelativeAddr(word, pos);
+        Emit({0x41, 0xF6, 0x04, 0x12, 0x01}); // test byte [r10 + rdx], 1
+        JumpToStub(0x85, pos);                // jnz
+        Emit({0x49, 0x89, 0x04, 0xD0});       // mov [r8 + rdx * 8], rax
+        return true;
+      }
+      return false;
+    }
+
+    // Compiles one instruction, returning its length, or nothing if the
+    // block has to end before it.
+    std::optional<int64_t> Compile(int64_t pos) {
+      auto fits = [&](int64_t len) {
+        if (pos + len > static_cast<int64_t>(mem.size()))
+          return false;
+        return std::none_of(dirty.begin() + pos,
+                            dirty.begin() + pos + len,
+                            [](uint8_t d) { return d != 0; });
+      };
+      if (!fits(1))
+        return std::nullopt;
+      Insn op;
+      try {
+        op = Insn{mem[pos]};
+      } catch (const std::exception&) {
+        return std::nullopt;
+      }
+      // Fixups from a half compiled instruction must go with its code.
+      const auto start       = buf.size();
+      const auto stubCount   = stubJumps.size();
+      const auto epilogCount = epilogueJumps.size();
+      switch (op.GetHandler()) {
+      case Insn::ADD:
+      case Insn::MULTIPLY:
+      case Insn::LESS_THAN:
+      case Insn::EQUALS:
+        if (!fits(4) || !Load(RAX, op.ParamA(), pos, pos + 1) ||
+            !Load(RCX, op.ParamB(), pos, pos + 2))
+          break;
+        if (op.GetHandler() == Insn::ADD)
+          Emit({0x48, 0x01, 0xC8}); // add rax, rcx
+        else if (op.GetHandler() == Insn::MULTIPLY)
+          Emit({0x48, 0x0F, 0xAF, 0xC1}); // imul rax, rcx
+        else
+          Emit({0x48,
+                0x39,
+                0xC8, // cmp rax, rcx
+                0x0F,
+                op.GetHandler() == Insn::LESS_THAN ? uint8_t{0x9C}
+                                                   : uint8_t{0x94},
+                0xC0, // setl/sete al
+                0x0F,
+                0xB6,
+                0xC0}); // movzx eax, al
+        if (!Store(op.ParamC(), pos, pos + 3))
+          break;
+        return 4;
+      case Insn::JUMP_IF_TRUE:
+      case Insn::JUMP_IF_FALSE: {
+        if (!fits(3) || !Load(RAX, op.ParamA(), pos, pos + 1) ||
+            !Load(RCX, op.ParamB(), pos, pos + 2))
+          break;
+        Emit({0x48, 0x85, 0xC0}); // test rax, rax
+        // Skip the taken path: jz for jump-if-true, jnz for jump-if-false.
+        Emit({0x0F,
+              op.GetHandler() == Insn::JUMP_IF_TRUE ? uint8_t{0x84}
+                                                    : uint8_t{0x85}});
+        const auto skip = buf.size();
+        Emit32(0);
+        auto label = labels.end();
+        if (op.ParamB() == ParamMode::IMMEDIATE)
+          label = labels.find(mem[pos + 2]);
+        if (label != labels.end()) {
+          Emit({0xE9});
+          Emit32(label->second - (buf.size() + 4));
+        } else {
+          Emit({0x48, 0x89, 0x4F, offsetof(IntCodeJitContext, insnPtr)});
+          Emit({0xB8});
+          Emit32(JUMP);
+          JumpToEpilogue();
+        }
+        Patch32(skip, buf.size() - (skip + 4));
+        return 3;
+      }
+      case Insn::ADJUST_REL_PTR:
+        if (!fits(2) || !Load(RAX, op.ParamA(), pos, pos + 1))
+          break;
+        Emit({0x49, 0x01, 0xC3}); // add r11, rax
+        return 2;
+      default:
+        break;
+      }
+      buf.resize(start);
+      stubJumps.resize(stubCount);
+      epilogueJumps.resize(epilogCount);
+      return std::nullopt;
+    }
+
+   public:
+    IntCodeJitCompiler(const std::vector<int64_t>& mem,
+                       const std::vector<uint8_t>& dirty)
+      : mem{mem}, dirty{dirty} {}
+
+    // Machine code for the block starting at pos, and the words it was
+    // compiled from. Empty if not even the first instruction compiles.
+    [[nodiscard]] std::pair<std::vector<uint8_t>, std::pair<int64_t, int64_t>>
+    CompileBlock(int64_t pos) {
+      Emit({0x4C, 0x8B, 0x07}); // mov r8, [rdi]
+      Emit({0x4C, 0x8B, 0x4F, offsetof(IntCodeJitContext, size)});
+      Emit({0x4C, 0x8B, 0x57, offsetof(IntCodeJitContext, code)});
+      Emit({0x4C, 0x8B, 0x5F, offsetof(IntCodeJitContext, relPtr)});
+      const auto begin = pos;
+      for (size_t count = 0; count < MAX_BLOCK_INSNS; ++count) {
+        labels.emplace(pos, buf.size());
+        const auto len = Compile(pos);
+        if (!len)
+          break;
+        pos += *len;
+      }
+      if (pos == begin)
+        return {};
+      ExitTo(pos, INTERPRET);
+      // Interpreter stubs, one per instruction which needs one.
+      std::unordered_map<int64_t, size_t> stubs;
+      for (auto [at, target] : stubJumps) {
+        auto [iter, added] = stubs.try_emplace(target, buf.size());
+        if (added)
+          ExitTo(target, INTERPRET);
+        Patch32(at, iter->second - (at + 4));
+      }
+      const auto epilogue = buf.size();
+      Emit({0x4C, 0x89, 0x5F, offsetof(IntCodeJitContext, relPtr)});
+      Emit({0xC3}); // ret
+      for (auto at : epilogueJumps)
+        Patch32(at, epilogue - (at + 4));
+      return {std::move(buf), {begin, pos}};
+    }
+  };
+#endif
+
+  // Runs Intcode by compiling basic blocks to x86-64 on first use, with the
+  // same interface and results as IntCodeComputer. Blocks run until a taken
+  // jump, I/O, or an instruction they can't handle; those go through a small
+  // interpreter, which is also what every instruction uses where the JIT is
+  // unavailable. A write into compiled code discards every block and marks
+  // the word so it is always interpreted from then on.
+  class IntCodeJit : public IntCodeFlatMachine {
+    using Block = int (*)(IntCodeJitContext*);
+
+    // Per word: written while part of a compiled block.
+    std::vector<uint8_t> dirty;
+    std::vector<Block> blocks;
+    std::vector<uint8_t> noBlock;
+#ifdef AOC_INTCODE_JIT
+    std::unique_ptr<JitCodeBuffer> codeBuffer;
+#endif
+
+    void CodeWritten(int64_t addr) override {
+      Flush();
+      dirty[addr] = 1;
+    }
+
+    void Grown(int64_t size) override {
+      dirty.resize(size);
+      blocks.resize(size);
+      noBlock.resize(size);
+    }
+
+    void Flush() {
+      std::fill(code.begin(), code.end(), 0);
+      std::fill(blocks.begin(), blocks.end(), nullptr);
+      std::fill(noBlock.begin(), noBlock.end(), 0);
+#ifdef AOC_INTCODE_JIT
+      if (codeBuffer)
+        codeBuffer->Clear();
+#endif
+    }
+
+    [[nodiscard]] Block Lookup(int64_t pos) {
+#ifdef AOC_INTCODE_JIT
+      if (!codeBuffer || pos < 0 || pos >= static_cast<int64_t>(mem.size()))
+        return nullptr;
+      if (blocks[pos] || noBlock[pos])
+        return blocks[pos];
+      auto [native, words] = IntCodeJitCompiler{mem, dirty}.CompileBlock(pos);
+      if (native.empty()) {
+        noBlock[pos] = 1;
+        return nullptr;
+      }
+      auto* entry = codeBuffer->Add(native);
+      if (!entry) {
+        Flush();
+        if (!(entry = codeBuffer->Add(native))) {
+          noBlock[pos] = 1;
+          return nullptr;
+        }
+      }
+      std::fill(code.begin() + words.first, code.begin() + words.second, 1);
+      return blocks[pos] = reinterpret_cast<Block>(entry);
+#else
+      static_cast<void>(pos);
+      return nullptr;
+#endif
+    }
+
+    ExecState Run() override {
+      while (true) {
+#ifdef AOC_INTCODE_JIT
+        if (auto block = Lookup(insnPtr)) {
+          IntCodeJitContext ctx{
+            mem.data(), mem.size(), code.data(), relPtr, insnPtr};
+          const auto exit = block(&ctx);
+          insnPtr         = ctx.insnPtr;
+          relPtr          = ctx.relPtr;
+          if (exit == IntCodeJitCompiler::JUMP)
+            continue;
+        }
+#endif
+        if (auto state = Step())
+          return *state;
+      }
+    }
+
+   public:
+    explicit IntCodeJit(const std::vector<int64_t>& program)
+        : IntCodeFlatMachine{program} {
+      Grown(mem.size());
+#ifdef AOC_INTCODE_JIT
+      codeBuffer = std::make_unique<JitCodeBuffer>(size_t{4} << 20);
+      if (!codeBuffer->Valid())
+        codeBuffer.reset();
+#endif
+    }
+
+    // Whether this build and system can generate native code. Without it
+    // every instruction is interpreted.
+    [[nodiscard]] bool Native() const noexcept {
+#ifdef AOC_INTCODE_JIT
+      return codeBuffer != nullptr;
+#else
+      return false;
+#endif
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEJIT
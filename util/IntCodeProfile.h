@@ -0,0 +1,206 @@
+#ifndef AOC_UTIL_INTCODEPROFILE
+#define AOC_UTIL_INTCODEPROFILE
+
+#include "util/IntCode.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AoC {
+  // Counts per address. Addresses near the program image are counted in a
+  // flat array, the rest in a hash map.
+  class IntCodeHistogram {
+    static constexpr int64_t NEAR_LIMIT = int64_t{1} << 20;
+
+    std::vector<uint64_t> near;
+    std::unordered_map<int64_t, uint64_t> far;
+
+   public:
+    void Add(int64_t key) {
+      if (key < 0 || key >= NEAR_LIMIT) {
+        ++far[key];
+        return;
+      }
+      if (key >= static_cast<int64_t>(near.size()))
+        near.resize(std::max<size_t>(key + 1, near.size() * 2));
+      ++near[key];
+    }
+
+    [[nodiscard]] uint64_t Total() const {
+      uint64_t ret = 0;
+      for (auto count : near)
+        ret += count;
+      for (auto& [key, count] : far)
+        ret += count;
+      return ret;
+    }
+
+    // The n most frequent keys, most frequent first.
+    [[nodiscard]] std::vector<std::pair<int64_t, uint64_t>> Top(
+      size_t n) const {
+      std::vector<std::pair<int64_t, uint64_t>> ret;
+      for (size_t key = 0; key < near.size(); ++key) {
+        if (near[key])
+          ret.emplace_back(key, near[key]);
+      }
+      ret.insert(ret.end(), far.begin(), far.end());
+      auto byCount = [](auto& lhs, auto& rhs) {
+        return lhs.second > rhs.second ||
+               (lhs.second == rhs.second && lhs.first < rhs.first);
+      };
+      n = std::min(n, ret.size());
+      std::partial_sort(ret.begin(), ret.begin() + n, ret.end(), byCount);
+      ret.resize(n);
+      return ret;
+    }
+  };
+
+  // A trace policy for BasicIntCodeComputer which profiles the program it
+  // runs: instructions executed per opcode and per address, taken backward
+  // jumps (loops), data reads and writes per address, and where and how far
+  // the relative base moves. It can also stream every instruction to a
+  // binary trace, see Stream().
+  class IntCodeProfiler {
+    struct EdgeHash {
+      size_t operator()(const std::pair<int64_t, int64_t>& edge) const {
+        return std::hash<int64_t>{}(edge.first * 0x9E3779B97F4A7C15 ^
+                                    edge.second);
+      }
+    };
+
+    std::array<uint64_t, Insn::HANDLERS> opcodes{};
+    IntCodeHistogram insns;
+    IntCodeHistogram reads;
+    IntCodeHistogram writes;
+    IntCodeHistogram relSites;
+    std::unordered_map<std::pair<int64_t, int64_t>, uint64_t, EdgeHash> loops;
+    int64_t relMin         = 0;
+    int64_t relMax         = 0;
+    std::ostream* traceOut = nullptr;
+    std::vector<char> traceBuf;
+
+    template <typename T>
+    void Put(T val) {
+      const auto at = traceBuf.size();
+      traceBuf.resize(at + sizeof(val));
+      std::memcpy(traceBuf.data() + at, &val, sizeof(val));
+    }
+
+   public:
+    static constexpr bool ENABLED = true;
+    // Trace records are the instruction address and relative base as int64
+    // and the opcode as one byte (an Insn::Handler), in host byte order,
+    // after this 8-byte header.
+    static constexpr char TRACE_MAGIC[8] = {
+      'I', 'C', 'T', 'R', 'A', 'C', 'E', 1};
+    static constexpr size_t TRACE_RECORD = 17;
+
+    IntCodeProfiler()                       = default;
+    IntCodeProfiler(const IntCodeProfiler&) = delete;
+    IntCodeProfiler& operator=(const IntCodeProfiler&) = delete;
+    ~IntCodeProfiler() { Flush(); }
+
+    // Starts writing a trace of every instruction executed to out, which
+    // must outlive the profiler or the next call to Flush().
+    void Stream(std::ostream& out) {
+      Flush();
+      traceOut = &out;
+      traceOut->write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    }
+
+    void Flush() {
+      if (traceOut && !traceBuf.empty())
+        traceOut->write(traceBuf.data(), traceBuf.size());
+      traceBuf.clear();
+    }
+
+    void OnInsn(int64_t addr, Insn op, int64_t relPtr) {
+      ++opcodes[op.GetHandler()];
+      insns.Add(addr);
+      if (!traceOut)
+        return;
+      Put(addr);
+      Put(relPtr);
+      Put(static_cast<uint8_t>(op.GetHandler()));
+      if (traceBuf.size() >= 1 << 16)
+        Flush();
+    }
+
+    void OnJump(int64_t from, int64_t to) {
+      if (to <= from)
+        ++loops[{from, to}];
+    }
+
+    void OnRead(int64_t addr) { reads.Add(addr); }
+    void OnWrite(int64_t addr) { writes.Add(addr); }
+
+    void OnRelPtr(int64_t addr, int64_t relPtr) {
+      relSites.Add(addr);
+      relMin = std::min(relMin, relPtr);
+      relMax = std::max(relMax, relPtr);
+    }
+
+    [[nodiscard]] uint64_t Opcode(Insn::Handler handler) const {
+      return opcodes[handler];
+    }
+    [[nodiscard]] const IntCodeHistogram& Insns() const { return insns; }
+    [[nodiscard]] const IntCodeHistogram& Reads() const { return reads; }
+    [[nodiscard]] const IntCodeHistogram& Writes() const { return writes; }
+    [[nodiscard]] const IntCodeHistogram& RelSites() const { return relSites; }
+
+    // Taken backward jumps as {from, to} and how often, most frequent first.
+    [[nodiscard]] std::vector<std::pair<std::pair<int64_t, int64_t>, uint64_t>>
+    Loops(size_t n) const {
+      std::vector<std::pair<std::pair<int64_t, int64_t>, uint64_t>> ret{
+        loops.begin(), loops.end()};
+      auto byCount = [](auto& lhs, auto& rhs) {
+        return lhs.second > rhs.second ||
+               (lhs.second == rhs.second && lhs.first < rhs.first);
+      };
+      n = std::min(n, ret.size());
+      std::partial_sort(ret.begin(), ret.begin() + n, ret.end(), byCount);
+      ret.resize(n);
+      return ret;
+    }
+
+    // A human-readable summary listing the top entries of each table.
+    void Report(std::ostream& out, size_t top = 10) const {
+      const auto total = insns.Total();
+      out << "Instructions: " << total << '\n';
+      for (size_t i = Insn::ADD; i < opcodes.size(); ++i) {
+        if (!opcodes[i])
+          continue;
+        out << "  " << std::left << std::setw(14)
+            << HandlerName(static_cast<Insn::Handler>(i)) << std::right
+            << std::setw(14) << opcodes[i] << std::fixed
+            << std::setprecision(1) << std::setw(7)
+            << 100.0 * opcodes[i] / total << "%\n";
+      }
+      auto table = [&](const char* title, const IntCodeHistogram& hist) {
+        out << title << ":\n";
+        for (auto& [addr, count] : hist.Top(top))
+          out << "  " << std::setw(10) << addr << std::setw(14) << count
+              << '\n';
+      };
+      table("Hottest addresses", insns);
+      out << "Hottest loops (jump -> target):\n";
+      for (auto& [edge, count] : Loops(top))
+        out << "  " << std::setw(10) << edge.first << " -> " << std::setw(10)
+            << edge.second << std::setw(14) << count << '\n';
+      table("Most read", reads);
+      table("Most written", writes);
+      table("Relative base adjusted at", relSites);
+      out << "Relative base range: [" << relMin << ", " << relMax << "]\n";
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODEPROFILE
@@ -0,0 +1,272 @@
+#ifndef AOC_UTIL_INTCODESNAPSHOT
+#define AOC_UTIL_INTCODESNAPSHOT
+
+#include "util/IntCode.h"
+#include "util/RingBuffer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define AOC_INTCODE_SNAPSHOT_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace AoC {
+  // FNV-1a over the words of a program image, which snapshots carry so that
+  // one taken from another program is never resumed by mistake.
+  [[nodiscard]] inline uint64_t IntCodeImageHash(
+    const std::vector<int64_t>& image) noexcept {
+    uint64_t ret = 0xCBF29CE484222325;
+    for (auto word : image) {
+      for (int i = 0; i < 8; ++i) {
+        ret ^= static_cast<uint64_t>(word >> (i * 8)) & 0xFF;
+        ret *= 0x100000001B3;
+      }
+    }
+    return ret;
+  }
+
+  // The saved state of an IntCodeComputer: its memory pages, instruction
+  // pointer, relative base and queued input and output. The file is laid
+  // out as a header, the page indices, the input and output queues, and
+  // then the pages themselves, exactly as IntCodeMemory holds them, at a
+  // 4 KiB aligned offset. On POSIX systems it is mmap'd privately, so
+  // resuming copies nothing: computers share the mapped pages and copy one
+  // only when they first write to it, and the decode cache comes back warm.
+  //
+  // Snapshots are in host byte order and page layout, and are only read by
+  // a build which agrees on both. Anything else is rejected when opened.
+  class IntCodeSnapshot {
+   public:
+    using Page = IntCodeMemory::Page;
+
+    static constexpr char MAGIC[8] = {'I', 'C', 'S', 'N', 'A', 'P', 0, 0};
+    static constexpr uint32_t VERSION     = 1;
+    static constexpr uint32_t ENDIAN_MARK = 0x01020304;
+    static constexpr uint64_t PAGE_ALIGN  = 4096;
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint32_t pageWords;
+      uint32_t pageBytes;
+      uint64_t imageHash;
+      int64_t insnPtr;
+      int64_t relPtr;
+      int64_t out;
+      uint64_t pages;
+      uint64_t inputs;
+      uint64_t outputs;
+      uint64_t pageOffset;
+    };
+
+   private:
+    std::shared_ptr<std::byte> data;
+    uint64_t size = 0;
+    Header header{};
+
+    [[nodiscard]] const int64_t* Words(uint64_t offset) const {
+      return reinterpret_cast<const int64_t*>(data.get() + offset);
+    }
+
+    [[nodiscard]] const int64_t* Indices() const {
+      return Words(sizeof(Header));
+    }
+
+    [[nodiscard]] const int64_t* Inputs() const {
+      return Indices() + header.pages;
+    }
+
+    [[nodiscard]] const int64_t* Outputs() const {
+      return Inputs() + header.inputs;
+    }
+
+    [[nodiscard]] Page* PageAt(uint64_t i) const {
+      return reinterpret_cast<Page*>(data.get() + header.pageOffset) + i;
+    }
+
+    [[nodiscard]] static uint64_t Align(uint64_t offset) {
+      return (offset + PAGE_ALIGN - 1) / PAGE_ALIGN * PAGE_ALIGN;
+    }
+
+    void Map(const std::string& path) {
+#ifdef AOC_INTCODE_SNAPSHOT_MMAP
+      const int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error{"Could not open snapshot " + path};
+      struct stat info {};
+      if (fstat(fd, &info) != 0 || info.st_size < 1) {
+        close(fd);
+        throw std::runtime_error{"Could not read snapshot " + path};
+      }
+      size = static_cast<uint64_t>(info.st_size);
+      // Private and writable: a computer that ends up as the only owner of a
+      // page writes it in place, and the kernel copies it for this process.
+      void* mem =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (mem == MAP_FAILED)
+        throw std::runtime_error{"Could not map snapshot " + path};
+      data = std::shared_ptr<std::byte>{
+        static_cast<std::byte*>(mem),
+        [len = size](std::byte* ptr) { munmap(ptr, len); }};
+#else
+      std::ifstream file{path, std::ios::binary | std::ios::ate};
+      if (!file)
+        throw std::runtime_error{"Could not open snapshot " + path};
+      size = static_cast<uint64_t>(file.tellg());
+      data = std::shared_ptr<std::byte>{
+        static_cast<std::byte*>(
+          ::operator new(size, std::align_val_t{PAGE_ALIGN})),
+        [](std::byte* ptr) {
+          ::operator delete(ptr, std::align_val_t{PAGE_ALIGN});
+        }};
+      file.seekg(0);
+      if (!file.read(reinterpret_cast<char*>(data.get()), size))
+        throw std::runtime_error{"Could not read snapshot " + path};
+#endif
+    }
+
+    void Validate() const {
+      if (size < sizeof(Header) ||
+          std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error{"Not an Intcode snapshot"};
+      if (header.version != VERSION)
+        throw std::runtime_error{"Unsupported Intcode snapshot version " +
+                                 std::to_string(header.version)};
+      if (header.byteOrder != ENDIAN_MARK ||
+          header.pageWords != IntCodeMemory::PAGE_WORDS ||
+          header.pageBytes != sizeof(Page))
+        throw std::runtime_error{"Intcode snapshot is from another platform"};
+      // Each count is checked alone first so that the sums can't overflow.
+      const auto words = size / sizeof(int64_t);
+      if (header.pages > words || header.inputs > words ||
+          header.outputs > words || header.pageOffset > size ||
+          header.pageOffset % PAGE_ALIGN != 0 ||
+          sizeof(Header) + (header.pages + header.inputs + header.outputs) *
+                               sizeof(int64_t) >
+            header.pageOffset ||
+          header.pages > (size - header.pageOffset) / sizeof(Page))
+        throw std::runtime_error{"Intcode snapshot is truncated"};
+      for (uint64_t i = 0; i < header.pages; ++i) {
+        if (Indices()[i] < 0 || (i && Indices()[i] <= Indices()[i - 1]))
+          throw std::runtime_error{"Intcode snapshot has bad page indices"};
+        const auto& decoded = PageAt(i)->decoded;
+        if (!std::all_of(decoded.begin(), decoded.end(), [](auto op) {
+              return op.Valid();
+            }))
+          throw std::runtime_error{"Intcode snapshot has a bad decode cache"};
+      }
+    }
+
+   public:
+    // Maps the snapshot at path, throwing if it can't be read or isn't one
+    // this build can resume.
+    explicit IntCodeSnapshot(const std::string& path) {
+      Map(path);
+      if (size >= sizeof(Header))
+        std::memcpy(&header, data.get(), sizeof(Header));
+      Validate();
+    }
+
+    // Writes the state of comp, which was loaded from image, to out. The
+    // trace isn't saved.
+    template <class Trace>
+    static void Save(const BasicIntCodeComputer<Trace>& comp,
+                     const std::vector<int64_t>& image,
+                     std::ostream& out) {
+      std::vector<std::pair<int64_t, const Page*>> pages;
+      comp.mem.ForEachPage([&](int64_t index, const Page& page) {
+        pages.emplace_back(index, &page);
+      });
+      std::sort(pages.begin(), pages.end());
+      std::vector<int64_t> words;
+      for (auto& [index, page] : pages)
+        words.emplace_back(index);
+      for (auto queue : {comp.input, comp.output}) {
+        while (!queue.Empty())
+          words.emplace_back(queue.Pop());
+      }
+
+      Header header{};
+      std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.version    = VERSION;
+      header.byteOrder  = ENDIAN_MARK;
+      header.pageWords  = IntCodeMemory::PAGE_WORDS;
+      header.pageBytes  = sizeof(Page);
+      header.imageHash  = IntCodeImageHash(image);
+      header.insnPtr    = comp.insnPtr;
+      header.relPtr     = comp.relPtr;
+      header.out        = comp.out;
+      header.pages      = pages.size();
+      header.inputs     = comp.input.Size();
+      header.outputs    = comp.output.Size();
+      const auto end    = sizeof(Header) + words.size() * sizeof(int64_t);
+      header.pageOffset = Align(end);
+
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(words.data()),
+                words.size() * sizeof(int64_t));
+      const std::vector<char> padding(header.pageOffset - end);
+      out.write(padding.data(), padding.size());
+      for (auto& [index, page] : pages)
+        out.write(reinterpret_cast<const char*>(page), sizeof(Page));
+      if (!out)
+        throw std::runtime_error{"Could not write Intcode snapshot"};
+    }
+
+    template <class Trace>
+    static void Save(const BasicIntCodeComputer<Trace>& comp,
+                     const std::vector<int64_t>& image,
+                     const std::string& path) {
+      std::ofstream file{path, std::ios::binary | std::ios::trunc};
+      Save(comp, image, file);
+      file.close();
+      if (!file)
+        throw std::runtime_error{"Could not write snapshot " + path};
+    }
+
+    [[nodiscard]] const Header& GetHeader() const noexcept { return header; }
+
+    // Whether the snapshot was taken of a computer loaded from image.
+    [[nodiscard]] bool Matches(const std::vector<int64_t>& image) const {
+      return header.imageHash == IntCodeImageHash(image);
+    }
+
+    // A computer in the saved state, sharing the snapshot's pages. Any
+    // number may be resumed from one snapshot, and they keep the mapping
+    // alive after the snapshot itself is gone.
+    template <class Trace = IntCodeNoTrace>
+    [[nodiscard]] BasicIntCodeComputer<Trace> Resume() const {
+      IntCodeMemory mem;
+      for (uint64_t i = 0; i < header.pages; ++i)
+        mem.Share(Indices()[i], std::shared_ptr<Page>{data, PageAt(i)});
+      BasicIntCodeComputer<Trace> ret{std::move(mem)};
+      for (uint64_t i = 0; i < header.inputs; ++i)
+        ret.input.Push(Inputs()[i]);
+      for (uint64_t i = 0; i < header.outputs; ++i)
+        ret.output.Push(Outputs()[i]);
+      ret.insnPtr = header.insnPtr;
+      ret.relPtr  = header.relPtr;
+      ret.out     = header.out;
+      return ret;
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_INTCODESNAPSHOT
@@ -0,0 +1,60 @@
+#ifndef AOC_UTIL_PARALLEL
+#define AOC_UTIL_PARALLEL
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace AoC {
+  [[nodiscard]] inline size_t WorkerCount(size_t jobs) {
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(cores, jobs));
+  }
+
+  // Calls func(state, i) for every i in [0, count) across all cores and folds
+  // the results together with reduce. Each worker owns one State, built by
+  // makeState, for the whole of its share of the range, so expensive scratch
+  // space is set up once per thread. The range is split into one contiguous
+  // block per worker and the blocks are folded in order, so the result never
+  // depends on thread timing. The first exception thrown by a worker is
+  // rethrown once every worker has stopped.
+  template <class Result, class MakeState, class Func, class Reduce>
+  [[nodiscard]] Result ParallelReduce(size_t count,
+                                      Result init,
+                                      MakeState makeState,
+                                      Func func,
+                                      Reduce reduce) {
+    const auto workers = WorkerCount(count);
+    std::vector<Result> results(workers, init);
+    std::vector<std::exception_ptr> errors(workers);
+    auto work = [&](size_t worker) {
+      try {
+        auto state      = makeState();
+        const auto last = count * (worker + 1) / workers;
+        for (auto i = count * worker / workers; i < last; ++i)
+          results[worker] = reduce(results[worker], func(state, i));
+      } catch (...) {
+        errors[worker] = std::current_exception();
+      }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker)
+      threads.emplace_back(work, worker);
+    work(0);
+    for (auto& thread : threads)
+      thread.join();
+    for (auto& error : errors) {
+      if (error)
+        std::rethrow_exception(error);
+    }
+    auto ret = init;
+    for (auto& result : results)
+      ret = reduce(ret, result);
+    return ret;
+  }
+} // namespace AoC
+
+#endif // AOC_UTIL_PARALLEL
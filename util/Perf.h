@@ -0,0 +1,182 @@
+#ifndef AOC_UTIL_PERF
+#define AOC_UTIL_PERF
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+#ifdef __linux__
+#  include <cerrno>
+#  include <cstring>
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+// Hardware event counts for a stretch of code, read through Linux
+// perf_event_open as one group so every event covers the same instructions.
+// Only user space on the calling thread is counted, so work handed to other
+// threads is missed. Events the kernel or hardware won't give us are left
+// out, and if none can be had, Available() is false and Reason() says why.
+namespace AoC::Perf {
+  enum Event : size_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    EVENT_COUNT,
+  };
+
+  inline constexpr std::array<const char*, EVENT_COUNT> EVENT_NAMES{
+    "cycles", "instructions", "branch-misses", "l1d-misses", "llc-misses"};
+
+  // Counts per event, indexed by Event.
+  using Sample = std::array<uint64_t, EVENT_COUNT>;
+
+  class Counters {
+    std::array<int, EVENT_COUNT> fds{-1, -1, -1, -1, -1};
+    // The events in the order the group reports them.
+    std::array<size_t, EVENT_COUNT> order{};
+    size_t opened = 0;
+    int leader    = -1;
+    std::string reason;
+
+#ifdef __linux__
+    static constexpr uint64_t CacheReadMiss(uint64_t cache) {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    static int Open(size_t event, int group) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      switch (event) {
+      case CYCLES:
+        attr.type   = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case INSTRUCTIONS:
+        attr.type   = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case BRANCH_MISSES:
+        attr.type   = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+      case L1D_MISSES:
+        attr.type   = PERF_TYPE_HW_CACHE;
+        attr.config = CacheReadMiss(PERF_COUNT_HW_CACHE_L1D);
+        break;
+      default:
+        attr.type   = PERF_TYPE_HW_CACHE;
+        attr.config = CacheReadMiss(PERF_COUNT_HW_CACHE_LL);
+        break;
+      }
+      attr.disabled       = group < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_GROUP |
+                         PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+#endif
+
+   public:
+    Counters() {
+#ifdef __linux__
+      for (size_t event = 0; event < EVENT_COUNT; ++event) {
+        const int fd = Open(event, leader);
+        if (fd < 0) {
+          if (leader < 0 && reason.empty())
+            reason = std::string{EVENT_NAMES[event]} + ": " +
+                     std::strerror(errno);
+          continue;
+        }
+        if (leader < 0)
+          leader = fd;
+        fds[event]      = fd;
+        order[opened++] = event;
+      }
+      if (leader >= 0)
+        reason.clear();
+#else
+      reason = "perf_event_open is only available on Linux";
+#endif
+    }
+
+    Counters(const Counters&)            = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    ~Counters() {
+#ifdef __linux__
+      for (const int fd : fds) {
+        if (fd >= 0)
+          close(fd);
+      }
+#endif
+    }
+
+    [[nodiscard]] bool Available() const { return leader >= 0; }
+
+    [[nodiscard]] bool Available(size_t event) const {
+      return fds[event] >= 0;
+    }
+
+    [[nodiscard]] const std::string& Reason() const { return reason; }
+
+    void Start() {
+#ifdef __linux__
+      if (!Available())
+        return;
+      ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Counts since Start(), scaled up if the kernel had to share the
+    // hardware with others and only counted for part of the time.
+    [[nodiscard]] Sample Stop() {
+      Sample ret{};
+#ifdef __linux__
+      if (!Available())
+        return ret;
+      ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      // Count, time enabled, time running, then a value per event.
+      std::array<uint64_t, 3 + EVENT_COUNT> data{};
+      if (read(leader, data.data(), sizeof(data)) < 0 || data[2] == 0)
+        return ret;
+      const double scale = static_cast<double>(data[1]) / data[2];
+      for (size_t i = 0; i < opened && i < data[0]; ++i)
+        ret[order[i]] = static_cast<uint64_t>(data[3 + i] * scale);
+#endif
+      return ret;
+    }
+  };
+
+  // One line of per run averages of totals, which were gathered over runs.
+  inline void Print(std::ostream& out,
+                    const Counters& counters,
+                    const Sample& totals,
+                    size_t runs) {
+    out << std::fixed << std::setprecision(0) << "   ";
+    for (size_t event = 0; event < EVENT_COUNT; ++event) {
+      if (counters.Available(event))
+        out << ' ' << EVENT_NAMES[event] << ' '
+            << static_cast<double>(totals[event]) / runs;
+    }
+    if (counters.Available(CYCLES) && counters.Available(INSTRUCTIONS) &&
+        totals[CYCLES])
+      out << std::setprecision(2) << " IPC "
+          << static_cast<double>(totals[INSTRUCTIONS]) / totals[CYCLES];
+    out << '\n';
+  }
+} // namespace AoC::Perf
+
+#endif // AOC_UTIL_PERF
@@ -0,0 +1,65 @@
+#ifndef AOC_UTIL_RINGBUFFER
+#define AOC_UTIL_RINGBUFFER
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace AoC {
+  // A FIFO over a power-of-two array. Pushing and popping never allocate
+  // once the buffer has reached the largest size it needs; it only grows
+  // when pushed while full.
+  template <typename T>
+  class RingBuffer {
+    std::vector<T> slots;
+    size_t head = 0;
+    size_t size = 0;
+
+    void Grow() {
+      std::vector<T> bigger(slots.size() * 2);
+      for (size_t i = 0; i < size; ++i)
+        bigger[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+      slots = std::move(bigger);
+      head  = 0;
+    }
+
+   public:
+    explicit RingBuffer(size_t capacity = 16) {
+      size_t slotCount = 1;
+      while (slotCount < capacity)
+        slotCount *= 2;
+      slots.resize(slotCount);
+    }
+
+    [[nodiscard]] bool Empty() const noexcept { return size == 0; }
+    [[nodiscard]] size_t Size() const noexcept { return size; }
+
+    void Push(T val) {
+      if (size == slots.size())
+        Grow();
+      slots[(head + size++) & (slots.size() - 1)] = std::move(val);
+    }
+
+    [[nodiscard]] const T& Front() const {
+      if (Empty())
+        throw std::out_of_range{"RingBuffer is empty"};
+      return slots[head];
+    }
+
+    T Pop() {
+      if (Empty())
+        throw std::out_of_range{"RingBuffer is empty"};
+      T ret = std::move(slots[head]);
+      head  = (head + 1) & (slots.size() - 1);
+      --size;
+      return ret;
+    }
+
+    void Clear() noexcept {
+      head = 0;
+      size = 0;
+    }
+  };
+} // namespace AoC
+
+#endif // AOC_UTIL_RINGBUFFER